@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * FNV-1a, a fast 64 bit hash for cache keys. hashes chain: pass the
+ * hash of what comes before to continue from it.
+ */
+uint64_t const FNV1A_BASIS = 0xcbf29ce484222325ull;
+
+constexpr uint64_t fnv1aOctet(unsigned char octet, uint64_t hash)
+{
+        return (hash ^ octet) * 0x100000001b3ull;
+}
+
+inline uint64_t fnv1a(void const* bytes, size_t size, uint64_t hash = FNV1A_BASIS)
+{
+        auto const octets = static_cast<unsigned char const*> (bytes);
+        for (size_t i = 0; i < size; i++) {
+                hash = fnv1aOctet(octets[i], hash);
+        }
+        return hash;
+}
+
+/// of a nul terminated string, terminator excluded, also at compile time
+constexpr uint64_t fnv1aString(char const* string, uint64_t hash = FNV1A_BASIS)
+{
+        while (*string) {
+                hash = fnv1aOctet(static_cast<unsigned char> (*string++), hash);
+        }
+        return hash;
+}
@@ -11,17 +11,28 @@ void createImageCaptureFramebuffer(FramebufferResource& framebuffer,
                                    TextureResource& framebufferResult,
                                    RenderbufferResource& renderbuffer,
                                    std::pair<int, int> resolution)
+{
+        createRenderTargetFramebuffer(framebuffer, framebufferResult,
+                                      &renderbuffer, resolution, GL_RGBA16F);
+}
+
+void createRenderTargetFramebuffer(FramebufferResource& framebuffer,
+                                   TextureResource& framebufferResult,
+                                   RenderbufferResource* renderbuffer,
+                                   std::pair<int, int> resolution,
+                                   unsigned internalFormat)
 {
         if (!GLEW_EXT_framebuffer_object) {
                 std::exit(1);
         }
 
         withTexture(framebufferResult,
-                    std::bind(defineNonMipmappedFloatTexture,
-                              resolution.first, resolution.second));
+                    std::bind(defineNonMipmappedTexture,
+                              resolution.first, resolution.second,
+                              internalFormat));
 
         withFramebuffer(framebuffer,
-        [&framebufferResult,&renderbuffer,resolution]() {
+        [&framebufferResult,renderbuffer,resolution]() {
                 glFramebufferTexture2D(GL_FRAMEBUFFER,
                                        GL_COLOR_ATTACHMENT0,
                                        GL_TEXTURE_2D,
@@ -41,13 +52,18 @@ void createImageCaptureFramebuffer(FramebufferResource& framebuffer,
                         std::exit(1);
                 }
 
-                withRenderbuffer(renderbuffer,
-                [resolution]() {
-                        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT,
-                                              resolution.first, resolution.second);
-                });
-                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-                                          GL_RENDERBUFFER, renderbuffer.id);
+                if (renderbuffer) {
+                        withRenderbuffer(*renderbuffer,
+                        [resolution]() {
+                                glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT,
+                                                      resolution.first, resolution.second);
+                        });
+                        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                                  GL_RENDERBUFFER, renderbuffer->id);
+                } else {
+                        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                                  GL_RENDERBUFFER, 0);
+                }
                 clear();
         });
 }
@@ -19,3 +19,13 @@ void createImageCaptureFramebuffer(FramebufferResource& framebuffer,
                                    TextureResource& framebufferResult,
                                    RenderbufferResource& depthbuffer,
                                    std::pair<int, int> resolution);
+
+/**
+ * as createImageCaptureFramebuffer, with a texture of the given
+ * internal format, and a depthbuffer only when one is given.
+ */
+void createRenderTargetFramebuffer(FramebufferResource& framebuffer,
+                                   TextureResource& framebufferResult,
+                                   RenderbufferResource* depthbuffer,
+                                   std::pair<int, int> resolution,
+                                   unsigned internalFormat);
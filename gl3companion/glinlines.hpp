@@ -1,5 +1,7 @@
 #pragma once
 
+#include "glstate.hpp"
+
 #include <GL/glew.h>
 
 #include <utility>
@@ -10,12 +12,12 @@ static inline GLfloat glfloat(double x)
         return static_cast<float> (x);
 }
 
+/// width and height of the viewport, from the state cache
 static inline std::pair<int, int> viewport()
 {
-        GLint wh[4];
-        glGetIntegerv(GL_VIEWPORT, wh);
+        auto const xywh = glstate::viewport();
 
-        return { wh[2], wh[3] };
+        return { xywh[2], xywh[3] };
 }
 
 static inline void clear()
@@ -0,0 +1,178 @@
+#include "glprogrambinaries.hpp"
+#include "fnv1a.hpp"
+#include "glresource_types.hpp"
+
+#include <GL/glew.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+struct ProgramBinaryHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourcesHash;
+        uint64_t driverHash;
+        uint64_t binaryHash;
+        uint32_t binaryFormat;
+        uint32_t binaryLength;
+};
+
+char const PROGRAM_BINARY_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+uint32_t const PROGRAM_BINARY_VERSION = 1;
+
+/// includes the terminator, so that moving text across strings changes the hash
+uint64_t fnv1aText(std::string const& text, uint64_t hash)
+{
+        return fnv1a(text.c_str(), text.size() + 1, hash);
+}
+
+uint64_t sourcesHashOf(std::string const& vertexShaderSource,
+                       std::string const& fragmentShaderSource)
+{
+        auto const hash = fnv1aText(vertexShaderSource, FNV1A_BASIS);
+        return fnv1aText(fragmentShaderSource, hash);
+}
+
+char const* glString(GLenum name)
+{
+        auto const string = reinterpret_cast<char const*> (glGetString(name));
+        return string ? string : "";
+}
+
+void makeDirectory(std::string const& path)
+{
+#if defined(_WIN32)
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+}
+}
+
+ProgramBinaryCache::ProgramBinaryCache(std::string const& directory) :
+        directory(directory)
+{
+        auto hash = fnv1aText(glString(GL_VENDOR), FNV1A_BASIS);
+        hash = fnv1aText(glString(GL_RENDERER), hash);
+        hash = fnv1aText(glString(GL_VERSION), hash);
+        driverHash = hash;
+
+        GLint formatCount = 0;
+        if (GLEW_ARB_get_program_binary) {
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        }
+        supported = formatCount > 0;
+}
+
+bool ProgramBinaryCache::load(ShaderProgramResource const& program,
+                              std::string const& vertexShaderSource,
+                              std::string const& fragmentShaderSource)
+{
+        if (!supported) {
+                return false;
+        }
+
+        // binaries are only retrievable when asked for before linking
+        auto const miss = [&program]() {
+                glProgramParameteri(program.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                    GL_TRUE);
+                return false;
+        };
+
+        auto const sourcesHash = sourcesHashOf(vertexShaderSource, fragmentShaderSource);
+        auto file = std::ifstream(pathOf(sourcesHash), std::ios::binary);
+        auto header = ProgramBinaryHeader {};
+        if (!file.read(reinterpret_cast<char*> (&header), sizeof header)
+            || std::memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof header.magic) != 0
+            || header.version != PROGRAM_BINARY_VERSION
+            || header.sourcesHash != sourcesHash
+            || header.driverHash != driverHash
+            || header.binaryLength == 0) {
+                return miss();
+        }
+
+        auto binary = std::vector<char> (header.binaryLength);
+        if (!file.read(&binary.front(), binary.size())
+            || fnv1a(&binary.front(), binary.size()) != header.binaryHash) {
+                return miss();
+        }
+
+        glProgramBinary(program.id, header.binaryFormat, &binary.front(),
+                        binary.size());
+
+        // drivers reject binaries they no longer understand
+        GLint status = GL_FALSE;
+        glGetProgramiv(program.id, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE) {
+                return miss();
+        }
+        return true;
+}
+
+void ProgramBinaryCache::store(ShaderProgramResource const& program,
+                               std::string const& vertexShaderSource,
+                               std::string const& fragmentShaderSource)
+{
+        if (!supported) {
+                return;
+        }
+
+        GLint length = 0;
+        glGetProgramiv(program.id, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+                return;
+        }
+
+        auto binary = std::vector<char> (length);
+        GLenum format = 0;
+        glGetProgramBinary(program.id, length, &length, &format, &binary.front());
+        binary.resize(length);
+
+        auto header = ProgramBinaryHeader {};
+        std::memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof header.magic);
+        header.version = PROGRAM_BINARY_VERSION;
+        header.sourcesHash = sourcesHashOf(vertexShaderSource, fragmentShaderSource);
+        header.driverHash = driverHash;
+        header.binaryHash = fnv1a(&binary.front(), binary.size());
+        header.binaryFormat = format;
+        header.binaryLength = binary.size();
+
+        makeDirectory(directory);
+
+        // written aside then renamed, so that readers never see a partial entry
+        auto const path = pathOf(header.sourcesHash);
+        auto const writePath = path + ".tmp";
+        {
+                auto file = std::ofstream(writePath, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<char const*> (&header), sizeof header);
+                file.write(&binary.front(), binary.size());
+                if (!file) {
+                        printf("ERROR: could not write program binary at %s\n",
+                               writePath.c_str());
+                        return;
+                }
+        }
+        std::remove(path.c_str());
+        if (std::rename(writePath.c_str(), path.c_str()) != 0) {
+                printf("ERROR: could not store program binary at %s\n", path.c_str());
+                std::remove(writePath.c_str());
+        }
+}
+
+std::string ProgramBinaryCache::pathOf(uint64_t sourcesHash) const
+{
+        char name[32];
+        snprintf(name, sizeof name, "%016llx.bin",
+                 static_cast<unsigned long long> (sourcesHash));
+        return directory + "/" + name;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class ShaderProgramResource;
+
+/**
+ * linked programs kept on disk, one file per pair of sources, for
+ * later runs to load instead of compiling them.
+ *
+ * entries record the driver which produced them. entries of another
+ * driver, truncated or corrupted, or rejected by the driver are
+ * reported as missing, and replaced once the program is recompiled.
+ */
+class ProgramBinaryCache
+{
+public:
+        /// @param directory created on the first store when missing
+        explicit ProgramBinaryCache(std::string const& directory);
+
+        /**
+         * define program from its stored binary.
+         *
+         * @returns false when there is no usable entry. the program is
+         * then to be compiled and linked from its sources, and stored.
+         */
+        bool load(ShaderProgramResource const& program,
+                  std::string const& vertexShaderSource,
+                  std::string const& fragmentShaderSource);
+
+        /// store the binary of a program linked after a failed load
+        void store(ShaderProgramResource const& program,
+                   std::string const& vertexShaderSource,
+                   std::string const& fragmentShaderSource);
+
+private:
+        ProgramBinaryCache(ProgramBinaryCache const&) = delete;
+        ProgramBinaryCache& operator=(ProgramBinaryCache const&) = delete;
+
+        std::string pathOf(uint64_t sourcesHash) const;
+
+        std::string directory;
+        /// of the vendor, renderer and version strings
+        uint64_t driverHash = 0;
+        bool supported = false;
+};
@@ -1,4 +1,5 @@
 #include "glresource_types.hpp"
+#include "glstate.hpp"
 
 TextureResource::TextureResource() : id(0)
 {
@@ -7,6 +8,7 @@ TextureResource::TextureResource() : id(0)
 
 TextureResource::~TextureResource()
 {
+        glstate::forgetTexture(id);
         glDeleteTextures(1, &id);
 }
 
@@ -17,6 +19,7 @@ FramebufferResource::FramebufferResource() : id(0)
 
 FramebufferResource::~FramebufferResource()
 {
+        glstate::forgetFramebuffer(id);
         glDeleteFramebuffers(1, &id);
 }
 
@@ -27,6 +30,7 @@ RenderbufferResource::RenderbufferResource() : id(0)
 
 RenderbufferResource::~RenderbufferResource()
 {
+        glstate::forgetRenderbuffer(id);
         glDeleteRenderbuffers(1, &id);
 }
 
@@ -37,6 +41,7 @@ BufferResource::BufferResource()
 
 BufferResource::~BufferResource()
 {
+        glstate::forgetBuffer(id);
         glDeleteBuffers(1, &id);
 }
 
@@ -47,6 +52,7 @@ VertexArrayResource::VertexArrayResource()
 
 VertexArrayResource::~VertexArrayResource()
 {
+        glstate::forgetVertexArray(id);
         glDeleteVertexArrays(1, &id);
 };
 
@@ -57,6 +63,7 @@ ShaderProgramResource::ShaderProgramResource()
 
 ShaderProgramResource::~ShaderProgramResource()
 {
+        glstate::forgetProgram(id);
         glDeleteProgram(id);
 };
 
@@ -80,58 +87,74 @@ FragmentShaderResource::~FragmentShaderResource()
         glDeleteShader(id);
 }
 
+// bindings are left in place for the next user, as they go through
+// the state cache. framebuffers are the exception: drawing code
+// expects the default framebuffer unless told otherwise.
+
 void withTexture(TextureResource const& texture,
                  std::function<void()> fn)
 {
-        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glstate::activeTexture(GL_TEXTURE0);
+        glstate::bindTexture(GL_TEXTURE_2D, texture.id);
         fn();
-        glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void withFramebuffer(FramebufferResource const& fb,
                      std::function<void ()> fn)
 {
-        glBindFramebuffer(GL_FRAMEBUFFER, fb.id);
+        glstate::bindFramebuffer(fb.id);
         fn();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glstate::bindFramebuffer(0);
 }
 
 void withRenderbuffer(RenderbufferResource const& fb,
                       std::function<void()> fn)
 {
-        glBindRenderbuffer(GL_RENDERBUFFER, fb.id);
+        glstate::bindRenderbuffer(fb.id);
         fn();
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
 
 void withArrayBuffer(BufferResource const& buffer,
                      std::function<void()> fn)
 {
-        glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+        glstate::bindBuffer(GL_ARRAY_BUFFER, buffer.id);
         fn();
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * element buffer bindings are part of the vertex array state, and
+ * core profiles have no default vertex array to hold them. this one
+ * holds them while defining buffers, away from those of the meshes.
+ *
+ * created once, for the lifetime of the context.
+ */
+static GLuint scratchVertexArray()
+{
+        static GLuint id = 0;
+        if (id == 0) {
+                glGenVertexArrays(1, &id);
+        }
+        return id;
 }
 
 void withElementBuffer(BufferResource const& buffer,
                        std::function<void()> fn)
 {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.id);
+        glstate::bindVertexArray(scratchVertexArray());
+        glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.id);
         fn();
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void withVertexArray(VertexArrayResource const& vertexArray,
                      std::function<void()> fn)
 {
-        glBindVertexArray(vertexArray.id);
+        glstate::bindVertexArray(vertexArray.id);
         fn();
-        glBindVertexArray(0);
 }
 
 void withShaderProgram(ShaderProgramResource const& program,
                        std::function<void()> fn)
 {
-        glUseProgram(program.id);
+        glstate::useProgram(program.id);
         fn();
-        glUseProgram(0);
 }
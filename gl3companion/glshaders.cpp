@@ -1,7 +1,9 @@
 #include "glresource_types.hpp"
+#include "glshaders.hpp"
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <sstream>
 #include <vector>
 
@@ -28,15 +30,44 @@ static std::vector<char const*> cstrsOf(std::vector<std::string const>& lines)
         return result;
 }
 
-static void innerCompile(GLuint id,
-                         std::string const& source)
+static bool hasParallelCompile()
 {
+        return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+static void setCompilerThreadsOnce()
+{
+        static bool done = false;
+        if (done) {
+                return;
+        }
+        done = true;
+
+        // as many compiler threads as the driver wants
+        auto const threads = ~GLuint(0);
+        if (GLEW_KHR_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsKHR(threads);
+        } else if (GLEW_ARB_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsARB(threads);
+        }
+}
+
+static void innerSubmitCompile(GLuint id,
+                               std::string const& source)
+{
+        setCompilerThreadsOnce();
+
         auto lines = splitLines(source);
         auto cstrs = cstrsOf(lines);
 
         glShaderSource(id, cstrs.size(), &cstrs.front(), NULL);
         glCompileShader(id);
+}
 
+/// @param source printed along errors, when not empty
+static bool isCompiled(GLuint id,
+                       std::string const& source)
+{
         GLint status;
         glGetShaderiv (id, GL_COMPILE_STATUS, &status);
         if (status == GL_FALSE) {
@@ -47,45 +78,99 @@ static void innerCompile(GLuint id,
                 sinfo.reserve(length + 1);
                 glGetShaderInfoLog(id, length, &length, &sinfo.front());
 
-                printf ("ERROR compiling shader [%s] with source [\n", &sinfo.front());
-                printf ("%s", source.c_str());
-                printf ("]\n");
+                if (source.empty()) {
+                        printf ("ERROR compiling shader [%s]\n", &sinfo.front());
+                } else {
+                        printf ("ERROR compiling shader [%s] with source [\n", &sinfo.front());
+                        printf ("%s", source.c_str());
+                        printf ("]\n");
+                }
+                return false;
+        }
+        return true;
+}
+
+static bool isLinked(GLuint id)
+{
+        GLint status;
+        glGetProgramiv (id, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE) {
+                GLint length;
+                glGetProgramiv (id, GL_INFO_LOG_LENGTH, &length);
+
+                std::vector<char> pinfo;
+                pinfo.reserve(length + 1);
+                glGetProgramInfoLog(id, length, &length, &pinfo.front());
+
+                printf ("ERROR linking shader [%s]\n", &pinfo.front());
+                return false;
         }
+        return true;
 }
 
 void compile(VertexShaderResource const& shader,
              std::string const& source)
 {
-        return innerCompile(shader.id, source);
+        innerSubmitCompile(shader.id, source);
+        isCompiled(shader.id, source);
 }
 
 void compile(FragmentShaderResource const& shader,
              std::string const& source)
 {
-        return innerCompile(shader.id, source);
+        innerSubmitCompile(shader.id, source);
+        isCompiled(shader.id, source);
 }
 
 void link(ShaderProgramResource const& program,
           VertexShaderResource const& vertexShader,
           FragmentShaderResource const& fragmentShader)
+{
+        submitLink(program, vertexShader, fragmentShader);
+        isLinked(program.id);
+}
+
+void submitCompile(VertexShaderResource const& shader,
+                   std::string const& source)
+{
+        innerSubmitCompile(shader.id, source);
+}
+
+void submitCompile(FragmentShaderResource const& shader,
+                   std::string const& source)
+{
+        innerSubmitCompile(shader.id, source);
+}
+
+void submitLink(ShaderProgramResource const& program,
+                VertexShaderResource const& vertexShader,
+                FragmentShaderResource const& fragmentShader)
 {
         glAttachShader(program.id, vertexShader.id);
         glAttachShader(program.id, fragmentShader.id);
         glLinkProgram(program.id);
+}
 
-        auto id = program.id;
-        GLint status;
-        glGetProgramiv (id, GL_LINK_STATUS, &status);
-        if (status == GL_FALSE) {
-                GLint length;
-                glGetShaderiv (id, GL_INFO_LOG_LENGTH, &length);
-
-                std::vector<char> sinfo;
-                sinfo.reserve(length + 1);
-                glGetShaderInfoLog(id, length, &length, &sinfo.front());
+LinkStatus pollLink(ShaderProgramResource const& program,
+                    VertexShaderResource const& vertexShader,
+                    FragmentShaderResource const& fragmentShader)
+{
+        if (hasParallelCompile()) {
+                // also GL_COMPLETION_STATUS_ARB
+                GLint completed = GL_FALSE;
+                glGetProgramiv(program.id, GL_COMPLETION_STATUS_KHR, &completed);
+                if (completed == GL_FALSE) {
+                        return LINK_PENDING;
+                }
+        }
 
-                printf ("ERROR linking shader [%s]\n", &sinfo.front());
+        // report the errors of both shaders
+        auto const vertexCompiled = isCompiled(vertexShader.id, "");
+        auto const fragmentCompiled = isCompiled(fragmentShader.id, "");
+        if (!vertexCompiled || !fragmentCompiled || !isLinked(program.id)) {
+                return LINK_FAILED;
         }
+        return LINK_SUCCEEDED;
 }
 
 void validate(ShaderProgramResource const& program)
@@ -105,3 +190,157 @@ void validate(ShaderProgramResource const& program)
                 printf ("ERROR: validating program [%s]\n", &pinfo.front());
         }
 }
+
+template <typename GetActiveFn, typename GetLocationFn>
+static ShaderVariables activeVariables(GLuint programId,
+                                       GLenum countParameter,
+                                       GLenum maxLengthParameter,
+                                       GetActiveFn getActive,
+                                       GetLocationFn getLocation)
+{
+        auto variables = ShaderVariables {};
+
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(programId, countParameter, &count);
+        glGetProgramiv(programId, maxLengthParameter, &maxLength);
+
+        auto name = std::vector<char> (maxLength + 1);
+        for (GLint i = 0; i < count; i++) {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = 0;
+                getActive(programId, i, name.size(), &length, &size, &type,
+                          &name.front());
+
+                auto const variableName = std::string { &name.front(), size_t(length) };
+                auto const variable = ShaderVariable {
+                        getLocation(programId, variableName.c_str()), type, size
+                };
+                variables.emplace(variableName, variable);
+
+                auto const arraySuffix = std::string { "[0]" };
+                if (variableName.size() > arraySuffix.size()
+                    && std::equal(std::begin(arraySuffix), std::end(arraySuffix),
+                                  std::end(variableName) - arraySuffix.size())) {
+                        variables.emplace(variableName.substr(0, variableName.size()
+                                                              - arraySuffix.size()),
+                                          variable);
+                }
+        }
+
+        return variables;
+}
+
+ShaderVariables activeUniforms(ShaderProgramResource const& program)
+{
+        return activeVariables(program.id,
+                               GL_ACTIVE_UNIFORMS,
+                               GL_ACTIVE_UNIFORM_MAX_LENGTH,
+                               glGetActiveUniform,
+                               glGetUniformLocation);
+}
+
+ShaderVariables activeAttributes(ShaderProgramResource const& program)
+{
+        return activeVariables(program.id,
+                               GL_ACTIVE_ATTRIBUTES,
+                               GL_ACTIVE_ATTRIBUTE_MAX_LENGTH,
+                               glGetActiveAttrib,
+                               glGetAttribLocation);
+}
+
+UniformBlocks activeUniformBlocks(ShaderProgramResource const& program)
+{
+        auto blocks = UniformBlocks {};
+
+        GLint blockCount = 0;
+        GLint maxBlockNameLength = 0;
+        glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+        glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH,
+                       &maxBlockNameLength);
+
+        auto blockName = std::vector<char> (maxBlockNameLength + 1);
+        for (GLint i = 0; i < blockCount; i++) {
+                GLsizei length = 0;
+                glGetActiveUniformBlockName(program.id, i, blockName.size(), &length,
+                                            &blockName.front());
+
+                auto block = UniformBlock {};
+                block.name = std::string { &blockName.front(), size_t(length) };
+                block.index = i;
+                glGetActiveUniformBlockiv(program.id, i, GL_UNIFORM_BLOCK_DATA_SIZE,
+                                          &block.dataSize);
+                blocks.push_back(block);
+        }
+
+        GLint uniformCount = 0;
+        GLint maxNameLength = 0;
+        glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        auto name = std::vector<char> (maxNameLength + 1);
+        for (GLuint i = 0; i < GLuint(uniformCount); i++) {
+                GLint blockIndex = -1;
+                glGetActiveUniformsiv(program.id, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+                if (blockIndex < 0 || blockIndex >= blockCount) {
+                        continue;
+                }
+
+                GLint offset = 0;
+                GLint arrayStride = 0;
+                GLint matrixStride = 0;
+                GLint isRowMajor = 0;
+                glGetActiveUniformsiv(program.id, 1, &i, GL_UNIFORM_OFFSET, &offset);
+                glGetActiveUniformsiv(program.id, 1, &i, GL_UNIFORM_ARRAY_STRIDE, &arrayStride);
+                glGetActiveUniformsiv(program.id, 1, &i, GL_UNIFORM_MATRIX_STRIDE, &matrixStride);
+                glGetActiveUniformsiv(program.id, 1, &i, GL_UNIFORM_IS_ROW_MAJOR, &isRowMajor);
+                auto const member = UniformBlockMember {
+                        offset, arrayStride, matrixStride, isRowMajor != 0
+                };
+
+                GLsizei length = 0;
+                glGetActiveUniformName(program.id, i, name.size(), &length, &name.front());
+                auto memberName = std::string { &name.front(), size_t(length) };
+
+                auto& block = blocks[blockIndex];
+                block.members.emplace(memberName, member);
+
+                auto const dropPrefix = [&memberName](std::string const& prefix) {
+                        if (memberName.size() > prefix.size()
+                            && std::equal(std::begin(prefix), std::end(prefix),
+                                          std::begin(memberName))) {
+                                memberName = memberName.substr(prefix.size());
+                                return true;
+                        }
+                        return false;
+                };
+                auto const dropSuffix = [&memberName](std::string const& suffix) {
+                        if (memberName.size() > suffix.size()
+                            && std::equal(std::begin(suffix), std::end(suffix),
+                                          std::end(memberName) - suffix.size())) {
+                                memberName = memberName.substr(0, memberName.size()
+                                                               - suffix.size());
+                                return true;
+                        }
+                        return false;
+                };
+                if (dropPrefix(block.name + ".")) {
+                        block.members.emplace(memberName, member);
+                }
+                if (dropSuffix("[0]")) {
+                        block.members.emplace(memberName, member);
+                }
+        }
+
+        return blocks;
+}
+
+int locationOf(ShaderVariables const& variables, std::string const& name)
+{
+        auto variable = variables.find(name);
+        if (variable == std::end(variables)) {
+                return -1;
+        }
+        return variable->second.location;
+}
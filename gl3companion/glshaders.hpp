@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 class FragmentShaderResource;
 class ShaderProgramResource;
@@ -14,3 +16,79 @@ void link(ShaderProgramResource const& program,
           VertexShaderResource const& vertexShader,
           FragmentShaderResource const& fragmentShader);
 void validate(ShaderProgramResource const& program);
+
+/**
+ * start compiling and linking a program, without waiting for the
+ * driver. compile and link errors are reported by pollLink.
+ */
+void submitCompile(VertexShaderResource const& shader,
+                   std::string const& source);
+void submitCompile(FragmentShaderResource const& shader,
+                   std::string const& source);
+void submitLink(ShaderProgramResource const& program,
+                VertexShaderResource const& vertexShader,
+                FragmentShaderResource const& fragmentShader);
+
+/// progress of a program submitted for linking
+enum LinkStatus {
+        LINK_PENDING,
+        LINK_SUCCEEDED,
+        LINK_FAILED,
+};
+
+/**
+ * poll a submitted program, reporting its errors once it completes.
+ *
+ * never blocks with GL_KHR_parallel_shader_compile or
+ * GL_ARB_parallel_shader_compile. without them, completion is only
+ * known by waiting for the driver.
+ */
+LinkStatus pollLink(ShaderProgramResource const& program,
+                    VertexShaderResource const& vertexShader,
+                    FragmentShaderResource const& fragmentShader);
+
+/// an active uniform or attribute of a linked program
+struct ShaderVariable {
+        int location;
+        /// GL type enum, e.g. GL_FLOAT_VEC4
+        unsigned int type;
+        /// array size, 1 for non arrays
+        int size;
+};
+
+using ShaderVariables = std::unordered_map<std::string, ShaderVariable>;
+
+/**
+ * introspect the active uniforms of a linked program, by name.
+ *
+ * arrays are also listed under their name without the [0] suffix.
+ */
+ShaderVariables activeUniforms(ShaderProgramResource const& program);
+
+/// introspect the active attributes of a linked program, by name.
+ShaderVariables activeAttributes(ShaderProgramResource const& program);
+
+/// placement of a uniform inside its block, in bytes
+struct UniformBlockMember {
+        int offset;
+        int arrayStride;
+        int matrixStride;
+        bool isRowMajor;
+};
+
+/// an active uniform block of a linked program
+struct UniformBlock {
+        std::string name;
+        unsigned int index;
+        int dataSize;
+        /// also listed without the block name prefix or [0] suffix
+        std::unordered_map<std::string, UniformBlockMember> members;
+};
+
+using UniformBlocks = std::vector<UniformBlock>;
+
+/// introspect the active uniform blocks of a linked program, by index
+UniformBlocks activeUniformBlocks(ShaderProgramResource const& program);
+
+/// @returns the location of a variable, -1 when inactive
+int locationOf(ShaderVariables const& variables, std::string const& name);
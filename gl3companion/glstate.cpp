@@ -0,0 +1,306 @@
+#include "glstate.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+
+namespace
+{
+GLuint const UNKNOWN_NAME = ~GLuint(0);
+int const UNKNOWN_FLAG = -1;
+
+GLenum const CACHED_BUFFER_TARGETS[] = {
+        GL_ARRAY_BUFFER,
+        GL_COPY_READ_BUFFER,
+        GL_COPY_WRITE_BUFFER,
+        GL_PIXEL_PACK_BUFFER,
+        GL_PIXEL_UNPACK_BUFFER,
+        GL_UNIFORM_BUFFER,
+};
+size_t const CACHED_BUFFER_TARGET_COUNT =
+        sizeof CACHED_BUFFER_TARGETS / sizeof CACHED_BUFFER_TARGETS[0];
+
+GLenum const CACHED_TEXTURE_TARGETS[] = {
+        GL_TEXTURE_1D,
+        GL_TEXTURE_2D,
+        GL_TEXTURE_3D,
+};
+size_t const CACHED_TEXTURE_TARGET_COUNT =
+        sizeof CACHED_TEXTURE_TARGETS / sizeof CACHED_TEXTURE_TARGETS[0];
+
+size_t const CACHED_TEXTURE_UNIT_COUNT = 32;
+
+struct State {
+        GLuint program;
+        GLuint vertexArray;
+        GLuint buffers[CACHED_BUFFER_TARGET_COUNT];
+        GLenum activeTextureUnit;
+        GLuint textures[CACHED_TEXTURE_UNIT_COUNT][CACHED_TEXTURE_TARGET_COUNT];
+        GLuint framebuffer;
+        GLuint renderbuffer;
+        bool viewportKnown;
+        std::array<GLint, 4> viewport;
+        int blend;
+        int depthTest;
+        int depthMask;
+        GLenum blendFactors[2];
+
+        glstate::Counters counters;
+};
+
+State makeUnknownState()
+{
+        auto state = State {};
+        state.program = UNKNOWN_NAME;
+        state.vertexArray = UNKNOWN_NAME;
+        std::fill(std::begin(state.buffers), std::end(state.buffers), UNKNOWN_NAME);
+        state.activeTextureUnit = UNKNOWN_NAME;
+        for (auto& unit : state.textures) {
+                std::fill(std::begin(unit), std::end(unit), UNKNOWN_NAME);
+        }
+        state.framebuffer = UNKNOWN_NAME;
+        state.renderbuffer = UNKNOWN_NAME;
+        state.viewportKnown = false;
+        state.blend = UNKNOWN_FLAG;
+        state.depthTest = UNKNOWN_FLAG;
+        state.depthMask = UNKNOWN_FLAG;
+        state.blendFactors[0] = UNKNOWN_NAME;
+        state.blendFactors[1] = UNKNOWN_NAME;
+        return state;
+}
+
+State state = makeUnknownState();
+
+/// @returns true when the value changed and must be sent to GL
+template <typename T>
+bool update(T& cached, T value)
+{
+        state.counters.calls++;
+        if (cached == value) {
+                state.counters.redundantCalls++;
+                return false;
+        }
+        cached = value;
+        return true;
+}
+
+template <size_t N>
+size_t indexOf(GLenum const (&targets)[N], GLenum target)
+{
+        return std::find(targets, targets + N, target) - targets;
+}
+
+void forget(GLuint& cached, GLuint name)
+{
+        if (cached == name) {
+                // GL reverts deleted bindings to 0
+                cached = 0;
+        }
+}
+}
+
+namespace glstate
+{
+void invalidate()
+{
+        auto const counters = state.counters;
+        state = makeUnknownState();
+        state.counters = counters;
+}
+
+void useProgram(GLuint program)
+{
+        if (update(state.program, program)) {
+                glUseProgram(program);
+        }
+}
+
+void bindVertexArray(GLuint vertexArray)
+{
+        if (update(state.vertexArray, vertexArray)) {
+                glBindVertexArray(vertexArray);
+        }
+}
+
+void bindBuffer(GLenum target, GLuint buffer)
+{
+        auto const index = indexOf(CACHED_BUFFER_TARGETS, target);
+        if (index == CACHED_BUFFER_TARGET_COUNT) {
+                state.counters.calls++;
+                glBindBuffer(target, buffer);
+                return;
+        }
+
+        if (update(state.buffers[index], buffer)) {
+                glBindBuffer(target, buffer);
+        }
+}
+
+void bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                     GLintptr offset, GLsizeiptr size)
+{
+        state.counters.calls++;
+        glBindBufferRange(target, index, buffer, offset, size);
+
+        auto const targetIndex = indexOf(CACHED_BUFFER_TARGETS, target);
+        if (targetIndex != CACHED_BUFFER_TARGET_COUNT) {
+                state.buffers[targetIndex] = buffer;
+        }
+}
+
+void activeTexture(GLenum unit)
+{
+        if (update(state.activeTextureUnit, unit)) {
+                glActiveTexture(unit);
+        }
+}
+
+void bindTexture(GLenum target, GLuint texture)
+{
+        auto const unitIndex = state.activeTextureUnit - GL_TEXTURE0;
+        auto const targetIndex = indexOf(CACHED_TEXTURE_TARGETS, target);
+        if (state.activeTextureUnit == UNKNOWN_NAME
+            || unitIndex >= CACHED_TEXTURE_UNIT_COUNT
+            || targetIndex == CACHED_TEXTURE_TARGET_COUNT) {
+                state.counters.calls++;
+                glBindTexture(target, texture);
+                return;
+        }
+
+        if (update(state.textures[unitIndex][targetIndex], texture)) {
+                glBindTexture(target, texture);
+        }
+}
+
+void bindFramebuffer(GLuint framebuffer)
+{
+        if (update(state.framebuffer, framebuffer)) {
+                glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+}
+
+void bindRenderbuffer(GLuint renderbuffer)
+{
+        if (update(state.renderbuffer, renderbuffer)) {
+                glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        }
+}
+
+void setViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+        auto const viewport = std::array<GLint, 4> { { x, y, width, height } };
+
+        state.counters.calls++;
+        if (state.viewportKnown && state.viewport == viewport) {
+                state.counters.redundantCalls++;
+                return;
+        }
+        state.viewportKnown = true;
+        state.viewport = viewport;
+        glViewport(x, y, width, height);
+}
+
+std::array<GLint, 4> viewport()
+{
+        if (!state.viewportKnown) {
+                glGetIntegerv(GL_VIEWPORT, &state.viewport.front());
+                state.viewportKnown = true;
+        }
+        return state.viewport;
+}
+
+void setCapability(GLenum capability, bool enabled)
+{
+        auto cached = static_cast<int*> (nullptr);
+        switch (capability) {
+        case GL_BLEND:
+                cached = &state.blend;
+                break;
+        case GL_DEPTH_TEST:
+                cached = &state.depthTest;
+                break;
+        }
+
+        if (cached && !update(*cached, enabled ? 1 : 0)) {
+                return;
+        }
+        if (!cached) {
+                state.counters.calls++;
+        }
+
+        if (enabled) {
+                glEnable(capability);
+        } else {
+                glDisable(capability);
+        }
+}
+
+void setBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+        state.counters.calls++;
+        if (state.blendFactors[0] == sourceFactor
+            && state.blendFactors[1] == destinationFactor) {
+                state.counters.redundantCalls++;
+                return;
+        }
+        state.blendFactors[0] = sourceFactor;
+        state.blendFactors[1] = destinationFactor;
+        glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void setDepthMask(bool enabled)
+{
+        if (update(state.depthMask, enabled ? 1 : 0)) {
+                glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+        }
+}
+
+void forgetTexture(GLuint texture)
+{
+        for (auto& unit : state.textures) {
+                for (auto& binding : unit) {
+                        forget(binding, texture);
+                }
+        }
+}
+
+void forgetBuffer(GLuint buffer)
+{
+        for (auto& binding : state.buffers) {
+                forget(binding, buffer);
+        }
+}
+
+void forgetVertexArray(GLuint vertexArray)
+{
+        forget(state.vertexArray, vertexArray);
+}
+
+void forgetFramebuffer(GLuint framebuffer)
+{
+        forget(state.framebuffer, framebuffer);
+}
+
+void forgetRenderbuffer(GLuint renderbuffer)
+{
+        forget(state.renderbuffer, renderbuffer);
+}
+
+void forgetProgram(GLuint program)
+{
+        if (state.program == program) {
+                // a deleted program stays in use until replaced
+                state.program = UNKNOWN_NAME;
+        }
+}
+
+Counters counters()
+{
+        return state.counters;
+}
+
+void resetCounters()
+{
+        state.counters = {};
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+
+/**
+ * shadow copy of the GL state of the current context, so that only
+ * actual changes reach the driver.
+ *
+ * once in use, all changes to the tracked state must go through
+ * these functions. call invalidate() when foreign code may have
+ * changed the state behind our back, e.g. between frames.
+ */
+namespace glstate
+{
+void invalidate();
+
+void useProgram(GLuint program);
+void bindVertexArray(GLuint vertexArray);
+/// element array bindings belong to the vertex array, and are not cached
+void bindBuffer(GLenum target, GLuint buffer);
+/// to an indexed binding point, which also binds the generic target
+void bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                     GLintptr offset, GLsizeiptr size);
+void activeTexture(GLenum unit);
+/// binds to the active texture unit
+void bindTexture(GLenum target, GLuint texture);
+void bindFramebuffer(GLuint framebuffer);
+void bindRenderbuffer(GLuint renderbuffer);
+
+void setViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+/// x, y, width, height. only queried from GL when unknown
+std::array<GLint, 4> viewport();
+
+/// for GL_BLEND and GL_DEPTH_TEST
+void setCapability(GLenum capability, bool enabled);
+void setBlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+void setDepthMask(bool enabled);
+
+/// GL names become unbound when deleted, and may be reused
+void forgetTexture(GLuint texture);
+void forgetBuffer(GLuint buffer);
+void forgetVertexArray(GLuint vertexArray);
+void forgetFramebuffer(GLuint framebuffer);
+void forgetRenderbuffer(GLuint renderbuffer);
+void forgetProgram(GLuint program);
+
+struct Counters {
+        /// state changes requested
+        long calls = 0;
+        /// requests matching the current state, not sent to the driver
+        long redundantCalls = 0;
+};
+
+Counters counters();
+void resetCounters();
+}
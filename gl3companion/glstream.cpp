@@ -0,0 +1,134 @@
+#include "glstream.hpp"
+#include "glstate.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+StreamBuffer::StreamBuffer(size_t capacity)
+{
+        allocate(capacity);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+        release();
+}
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+        return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t StreamBuffer::write(void const* data, size_t size, size_t alignment)
+{
+        // enough for the data wherever it starts in a region
+        auto const footprint = size + alignment - 1;
+        if (footprint > regionSize) {
+                allocate(std::max(2 * capacity,
+                                  REGION_COUNT * alignUp(footprint, REGION_ALIGNMENT)));
+        }
+
+        auto offset = alignUp(head, alignment);
+        if (offset + size > (region + 1) * regionSize) {
+                enterRegion((region + 1) % REGION_COUNT);
+                offset = alignUp(head, alignment);
+        }
+
+        if (persistent) {
+                std::memcpy(mapping + offset, data, size);
+        } else {
+                glstate::bindBuffer(GL_COPY_WRITE_BUFFER, storage.id);
+                auto const destination =
+                        glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+                                         GL_MAP_WRITE_BIT
+                                         | GL_MAP_INVALIDATE_RANGE_BIT
+                                         | GL_MAP_UNSYNCHRONIZED_BIT);
+                if (destination) {
+                        std::memcpy(destination, data, size);
+                        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+                }
+        }
+
+        head = offset + size;
+        return offset;
+}
+
+void StreamBuffer::allocate(size_t newCapacity)
+{
+        release();
+
+        // the previous storage is released once the GPU is done with it
+        auto fresh = BufferResource {};
+        std::swap(storage.id, fresh.id);
+
+        capacity = newCapacity;
+        regionSize = capacity / REGION_COUNT / REGION_ALIGNMENT * REGION_ALIGNMENT;
+        region = 0;
+        head = 0;
+
+        persistent = GLEW_ARB_buffer_storage != 0;
+        glstate::bindBuffer(GL_COPY_WRITE_BUFFER, storage.id);
+        if (persistent) {
+                auto const flags = GL_MAP_WRITE_BIT
+                                   | GL_MAP_PERSISTENT_BIT
+                                   | GL_MAP_COHERENT_BIT;
+                glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr, flags);
+                mapping = static_cast<char*> (glMapBufferRange(GL_COPY_WRITE_BUFFER, 0,
+                                              capacity, flags));
+                if (!mapping) {
+                        printf("could not map stream buffer persistently\n");
+                        persistent = false;
+                        auto plain = BufferResource {};
+                        std::swap(storage.id, plain.id);
+                        glstate::bindBuffer(GL_COPY_WRITE_BUFFER, storage.id);
+                }
+        }
+        if (!persistent) {
+                glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        }
+}
+
+void StreamBuffer::release()
+{
+        for (auto& fence : fences) {
+                if (fence) {
+                        glDeleteSync(fence);
+                        fence = nullptr;
+                }
+        }
+
+        if (mapping) {
+                glstate::bindBuffer(GL_COPY_WRITE_BUFFER, storage.id);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+                mapping = nullptr;
+        }
+}
+
+void StreamBuffer::enterRegion(size_t newRegion)
+{
+        if (!persistent) {
+                if (newRegion == 0) {
+                        // orphan the storage still read by the GPU
+                        glstate::bindBuffer(GL_COPY_WRITE_BUFFER, storage.id);
+                        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+                }
+        } else {
+                // draws reading the region we leave have all been issued
+                fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+                auto& fence = fences[newRegion];
+                if (fence) {
+                        auto const timeout = GLuint64(1000000000);
+                        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout)
+                               == GL_TIMEOUT_EXPIRED) {
+                        }
+                        glDeleteSync(fence);
+                        fence = nullptr;
+                }
+        }
+
+        region = newRegion;
+        head = region * regionSize;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "glresource_types.hpp"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/**
+ * ring of buffer storage for data rewritten every frame, such as
+ * streamed geometry. vertices and indices may share it.
+ *
+ * persistently mapped when the driver supports buffer storage. the
+ * ring is then split in regions, each guarded by a fence, so that
+ * data is never overwritten before the GPU is done reading it.
+ * otherwise written with unsynchronized maps, and orphaned when full.
+ */
+class StreamBuffer
+{
+public:
+        explicit StreamBuffer(size_t capacity = size_t(1) << 20);
+        ~StreamBuffer();
+
+        /// @returns the offset of the copied data in buffer(), in bytes
+        size_t write(void const* data, size_t size, size_t alignment = 16);
+
+        /// changes when the ring has to grow
+        GLuint buffer() const
+        {
+                return storage.id;
+        }
+
+private:
+        StreamBuffer(StreamBuffer const&) = delete;
+        StreamBuffer& operator=(StreamBuffer const&) = delete;
+
+        void allocate(size_t newCapacity);
+        void release();
+        void enterRegion(size_t newRegion);
+
+        static size_t const REGION_COUNT = 3;
+        /// of region starts, so that they suit any power of two up to it
+        static size_t const REGION_ALIGNMENT = 256;
+
+        BufferResource storage;
+        bool persistent = false;
+        char* mapping = nullptr;
+        size_t capacity = 0;
+        size_t regionSize = 0;
+        size_t region = 0;
+        size_t head = 0;
+        GLsync fences[REGION_COUNT] = {};
+};
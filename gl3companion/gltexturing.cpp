@@ -31,6 +31,26 @@ void defineNonMipmappedFloatTexture(
 
 }
 
+void defineNonMipmappedTexture(int const width, int const height,
+                               unsigned const internalFormat)
+{
+        auto const target = GL_TEXTURE_2D;
+
+        // no mipmapping
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+
+        glTexImage2D(target,
+                     0,
+                     internalFormat,
+                     width,
+                     height,
+                     0,
+                     GL_RGBA,
+                     GL_UNSIGNED_INT_8_8_8_8_REV,
+                     NULL);
+}
+
 // pixels are layed out in rows of width pixels from 0 to height
 void defineNonMipmappedARGB32Texture(
         int const width, int const height,
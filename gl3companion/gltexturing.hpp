@@ -9,6 +9,13 @@
  */
 void defineNonMipmappedFloatTexture(int const width, int const height);
 
+/**
+ * call while a texture is bound to define a non mipmapped 2d texture
+ * of the given internal format, with undefined content.
+ */
+void defineNonMipmappedTexture(int const width, int const height,
+                               unsigned const internalFormat);
+
 
 /**
  * call while a texture bound to define a non mipmapped 2d texture
@@ -0,0 +1,118 @@
+#include "framegraph.hpp"
+
+#include <utility>
+
+GraphTarget transientTarget(FrameGraph& graph, ScratchTargetDef const& spec)
+{
+        graph.targets.push_back({ false, {}, spec });
+        return { uint32_t(graph.targets.size() - 1) };
+}
+
+GraphTarget importTarget(FrameGraph& graph, TargetHandle target)
+{
+        graph.targets.push_back({ true, target, { 0, 0 } });
+        return { uint32_t(graph.targets.size() - 1) };
+}
+
+void addPass(FrameGraph& graph,
+             std::initializer_list<GraphTarget> reads,
+             GraphTarget write,
+             FragmentOperationsDef const& fragmentOperations,
+             FrameGraph::DrawFn draw)
+{
+        auto pass = FrameGraph::Pass {};
+        for (auto const& read : reads) {
+                pass.reads.push_back(read.index);
+        }
+        pass.write = write.index;
+        pass.clears = fragmentOperations.flags & FragmentOperationsDef::CLEAR;
+        pass.draw = std::move(draw);
+        graph.passes.push_back(std::move(pass));
+}
+
+TextureHandle graphTexture(FrameSeries& output, FrameGraph const& graph,
+                           GraphTarget target)
+{
+        auto const handle = graph.targets[target.index].handle;
+        if (!handle.defined()) {
+                return {};
+        }
+        return targetTexture(output, handle);
+}
+
+void execute(FrameSeries& output, FrameGraph& graph)
+{
+        auto& targets = graph.targets;
+        auto& passes = graph.passes;
+        auto& needed = graph.needed;
+        auto& live = graph.live;
+        auto& lastUses = graph.lastUses;
+
+        // walking back from the end of the frame, a pass is live when
+        // the content it writes is still needed by a later live pass,
+        // or by the next frames for imported targets.
+        needed.assign(targets.size(), false);
+        for (size_t i = 0; i < targets.size(); i++) {
+                needed[i] = targets[i].imported;
+        }
+        live.assign(passes.size(), false);
+        for (auto i = passes.size(); i-- > 0;) {
+                auto const& pass = passes[i];
+                if (!needed[pass.write]) {
+                        continue;
+                }
+                live[i] = true;
+                needed[pass.write] = !pass.clears;
+                for (auto read : pass.reads) {
+                        needed[read] = true;
+                }
+        }
+
+        // last live pass using each target, after which its
+        // framebuffer may be handed to another target
+        lastUses.assign(targets.size(), 0);
+        for (size_t i = 0; i < passes.size(); i++) {
+                if (!live[i]) {
+                        continue;
+                }
+                lastUses[passes[i].write] = i;
+                for (auto read : passes[i].reads) {
+                        lastUses[read] = i;
+                }
+        }
+
+        auto const forEachTarget = [](FrameGraph::Pass const& pass, auto fn) {
+                fn(pass.write);
+                for (auto read : pass.reads) {
+                        fn(read);
+                }
+        };
+
+        for (size_t i = 0; i < passes.size(); i++) {
+                if (!live[i]) {
+                        continue;
+                }
+                auto const& pass = passes[i];
+
+                forEachTarget(pass, [&](uint32_t target) {
+                        auto& entry = targets[target];
+                        if (!entry.imported && !entry.handle.defined()) {
+                                entry.handle = scratchTarget(output, entry.spec);
+                        }
+                });
+
+                pass.draw(output, targets[pass.write].handle);
+
+                forEachTarget(pass, [&](uint32_t target) {
+                        auto& entry = targets[target];
+                        if (!entry.imported && entry.handle.defined()
+                            && lastUses[target] == i) {
+                                releaseScratchTarget(output, entry.handle);
+                                entry.handle = {};
+                        }
+                });
+        }
+
+        targets.clear();
+        passes.clear();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include "../src/estd.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+/// a target of a frame graph, valid until the graph is executed
+struct GraphTarget {
+        uint32_t index = ~0u;
+};
+
+/**
+ * passes of a frame, declared with the targets they read and write.
+ *
+ * on execution, passes run in declaration order, minus those whose
+ * writes never reach an imported target. transient targets are
+ * scratch targets of the frame series, returned to its pool after
+ * their last use, so that targets whose lifetimes do not overlap
+ * share a framebuffer.
+ *
+ * declarations are consumed by execute(). the graph keeps its storage
+ * from one frame to the next, so that a graph redeclared every frame
+ * does not allocate once its frame shape is known.
+ */
+struct FrameGraph {
+        /// inline, e.g. a lambda capturing up to 8 references
+        using DrawFn = estd::inplace_function<void(FrameSeries& output, TargetHandle target), 64>;
+
+        struct Target {
+                bool imported;
+                /// undefined for the current framebuffer, or for transient
+                /// targets not acquired yet
+                TargetHandle handle;
+                /// of transient targets
+                ScratchTargetDef spec;
+        };
+
+        struct Pass {
+                estd::small_vector<uint32_t, 4> reads;
+                uint32_t write;
+                /// previous content of the target is not needed
+                bool clears;
+                DrawFn draw;
+        };
+
+        std::vector<Target> targets;
+        std::vector<Pass> passes;
+
+        // scratch of execute()
+        std::vector<bool> needed;
+        std::vector<bool> live;
+        std::vector<size_t> lastUses;
+};
+
+/// a target for this frame only, with undefined initial content
+GraphTarget transientTarget(FrameGraph& graph, ScratchTargetDef const& spec);
+
+/**
+ * a target defined outside of the graph, whose content outlives the
+ * frame. the undefined handle stands for the current framebuffer.
+ */
+GraphTarget importTarget(FrameGraph& graph, TargetHandle target);
+
+/**
+ * @param reads targets whose textures the pass samples
+ * @param write target the pass draws into
+ * @param fragmentOperations of the draws of the pass. with CLEAR, the
+ * pass does not depend on earlier writes to its target.
+ */
+void addPass(FrameGraph& graph,
+             std::initializer_list<GraphTarget> reads,
+             GraphTarget write,
+             FragmentOperationsDef const& fragmentOperations,
+             FrameGraph::DrawFn draw);
+
+/// texture of a target, for the passes reading it
+TextureHandle graphTexture(FrameSeries& output, FrameGraph const& graph,
+                           GraphTarget target);
+
+/// run the passes needed for the imported targets, then reset the graph
+void execute(FrameSeries& output, FrameGraph& graph);
@@ -0,0 +1,200 @@
+#include "framepipeline.hpp"
+
+#include "../src/estd.hpp"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class FramePipeline
+{
+public:
+        FramePipeline(FrameUpdateFn update, size_t framesInFlight) :
+                update(std::move(update)),
+                fences(framesInFlight, nullptr)
+        {
+                updateThread = std::thread([this]() {
+                        work();
+                });
+        }
+
+        ~FramePipeline()
+        {
+                {
+                        auto lock = std::unique_lock<std::mutex>(mutex);
+                        stopping = true;
+                }
+                changed.notify_all();
+                updateThread.join();
+
+                for (auto& fence : fences) {
+                        if (fence) {
+                                glDeleteSync(fence);
+                        }
+                }
+        }
+
+        void executeNextFrame(FrameSeries& output, uint64_t time_micros)
+        {
+                auto lock = std::unique_lock<std::mutex>(mutex);
+                if (!requested && !hasReady()) {
+                        request(time_micros);
+                }
+                changed.wait(lock, [this]() {
+                        return hasReady();
+                });
+
+                auto& snapshot = snapshots[oldestReady()];
+                snapshot.state = Snapshot::EXECUTING;
+
+                // the next frame is expected one frame duration later
+                auto const frameDuration = previousTime && time_micros > previousTime
+                                           ? time_micros - previousTime : 0;
+                previousTime = time_micros;
+                request(time_micros + frameDuration);
+                lock.unlock();
+
+                throttle();
+                execute(output, snapshot.commands);
+                fences[frame % fences.size()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                frame++;
+
+                lock.lock();
+                snapshot.state = Snapshot::FREE;
+                changed.notify_all();
+        }
+
+private:
+        struct Snapshot {
+                enum State {
+                        FREE,
+                        RECORDING,
+                        READY,
+                        EXECUTING,
+                };
+
+                State state = FREE;
+                uint64_t sequence = 0;
+                CommandBuffer commands;
+        };
+
+        /// wait for the GPU to finish the frame framesInFlight frames ago
+        void throttle()
+        {
+                auto& fence = fences[frame % fences.size()];
+                if (!fence) {
+                        return;
+                }
+                auto const timeout = GLuint64(1000000000);
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout)
+                       == GL_TIMEOUT_EXPIRED) {
+                }
+                glDeleteSync(fence);
+                fence = nullptr;
+        }
+
+        void request(uint64_t time_micros)
+        {
+                requested = true;
+                requestedTime = time_micros;
+                changed.notify_all();
+        }
+
+        bool hasReady() const
+        {
+                for (auto const& snapshot : snapshots) {
+                        if (snapshot.state == Snapshot::READY) {
+                                return true;
+                        }
+                }
+                return false;
+        }
+
+        size_t oldestReady() const
+        {
+                auto oldest = size_t(0);
+                for (size_t i = 0; i < SNAPSHOT_COUNT; i++) {
+                        auto const& snapshot = snapshots[i];
+                        if (snapshot.state == Snapshot::READY
+                            && (snapshots[oldest].state != Snapshot::READY
+                                || snapshot.sequence < snapshots[oldest].sequence)) {
+                                oldest = i;
+                        }
+                }
+                return oldest;
+        }
+
+        size_t freeSnapshot() const
+        {
+                for (size_t i = 0; i < SNAPSHOT_COUNT; i++) {
+                        if (snapshots[i].state == Snapshot::FREE) {
+                                return i;
+                        }
+                }
+                return SNAPSHOT_COUNT;
+        }
+
+        void work()
+        {
+                auto lock = std::unique_lock<std::mutex>(mutex);
+                for (;;) {
+                        changed.wait(lock, [this]() {
+                                return stopping
+                                       || (requested && freeSnapshot() != SNAPSHOT_COUNT);
+                        });
+                        if (stopping) {
+                                return;
+                        }
+
+                        auto& snapshot = snapshots[freeSnapshot()];
+                        snapshot.state = Snapshot::RECORDING;
+                        snapshot.sequence = ++sequence;
+                        auto const time_micros = requestedTime;
+                        requested = false;
+                        lock.unlock();
+
+                        // schemas are kept, their indices stay valid
+                        snapshot.commands.bytes.clear();
+                        update(snapshot.commands, time_micros);
+
+                        lock.lock();
+                        snapshot.state = Snapshot::READY;
+                        changed.notify_all();
+                }
+        }
+
+        /// one executing, one ready, one being recorded
+        static size_t const SNAPSHOT_COUNT = 3;
+
+        FrameUpdateFn update;
+        std::thread updateThread;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool stopping = false;
+        bool requested = false;
+        uint64_t requestedTime = 0;
+        uint64_t sequence = 0;
+        Snapshot snapshots[SNAPSHOT_COUNT];
+
+        // GL thread only
+        std::vector<GLsync> fences;
+        uint64_t frame = 0;
+        uint64_t previousTime = 0;
+};
+
+FramePipelineResource makeFramePipeline(FrameUpdateFn update,
+                                        size_t framesInFlight)
+{
+        return estd::make_unique<FramePipeline>(std::move(update), framesInFlight);
+}
+
+void executeNextFrame(FrameSeries& output, FramePipeline& pipeline,
+                      uint64_t time_micros)
+{
+        pipeline.executeNextFrame(output, time_micros);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/**
+ * two stage pipeline, where an update thread records the draws of the
+ * next frame while the GL thread executes the current one.
+ *
+ * frames are recorded into a ring of command buffers. The GL thread
+ * waits on a fence before getting more than framesInFlight frames
+ * ahead of the GPU.
+ *
+ * recording cannot define resources: programs, meshes, textures and
+ * targets are defined by handle on the GL thread beforehand.
+ */
+class FramePipeline;
+using FramePipelineResource =
+        std::unique_ptr<FramePipeline, std::function<void(FramePipeline*)>>;
+
+/// records the frame to show at time_micros, on the update thread
+using FrameUpdateFn = std::function<void(CommandBuffer& commands, uint64_t time_micros)>;
+
+FramePipelineResource makeFramePipeline(FrameUpdateFn update,
+                                        size_t framesInFlight = 2);
+
+/**
+ * on the GL thread, execute the next recorded frame, and have the
+ * update thread record the one after it, for the time it is expected
+ * to be shown.
+ *
+ * the first call waits for its frame to be recorded.
+ */
+void executeNextFrame(FrameSeries& output, FramePipeline& pipeline,
+                      uint64_t time_micros);
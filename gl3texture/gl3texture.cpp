@@ -1,6 +1,7 @@
 #include "../gl3companion/gldebug.hpp"
 #include "../gl3companion/glresource_types.hpp"
 #include "../gl3companion/glshaders.hpp"
+#include "../gl3companion/glstate.hpp"
 #include "../gl3companion/gltexturing.hpp"
 #include "../src/hstd.hpp"
 #include "quad.hpp"
@@ -26,6 +27,9 @@ extern void render_next_2chn_48khz_audio(uint64_t time_micros,
 
 extern void render_next_gl3(uint64_t time_micros)
 {
+        // the runtime may change the GL state between frames
+        glstate::invalidate();
+
         render_textured_quad_v1(time_micros);
         render_textured_quad_v2(time_micros);
 }
@@ -1,8 +1,11 @@
 // implementations
 
 #include "../gl3companion/glframebuffers.cpp"
+#include "../gl3companion/glprogrambinaries.cpp"
 #include "../gl3companion/glresources.cpp"
 #include "../gl3companion/glshaders.cpp"
+#include "../gl3companion/glstate.cpp"
+#include "../gl3companion/glstream.cpp"
 #include "../gl3companion/gltexturing.cpp"
 #include "../ref/fs.cpp"
 
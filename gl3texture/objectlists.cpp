@@ -0,0 +1,120 @@
+#include "objectlists.hpp"
+
+#include "../src/estd.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ObjectListBuilder
+{
+public:
+        ObjectListBuilder(size_t workerCount)
+        {
+                for (size_t i = 0; i < workerCount; i++) {
+                        workers.emplace_back([this]() {
+                                work();
+                        });
+                }
+        }
+
+        ~ObjectListBuilder()
+        {
+                {
+                        auto lock = std::unique_lock<std::mutex>(mutex);
+                        stopping = true;
+                }
+                wake.notify_all();
+                for (auto& worker : workers) {
+                        worker.join();
+                }
+        }
+
+        RenderObjects build(size_t count, ObjectBuildFn const& fn)
+        {
+                if (objects.size() < count) {
+                        objects.resize(count);
+                }
+
+                auto lock = std::unique_lock<std::mutex>(mutex);
+                job = &fn;
+                objectCount = count;
+                // a few chunks per thread, to even out uneven builders
+                chunkCount = std::min(count, 4 * (workers.size() + 1));
+                nextChunk = 0;
+                pendingChunks = chunkCount;
+                wake.notify_all();
+
+                while (nextChunk < chunkCount) {
+                        runChunk(lock);
+                }
+                done.wait(lock, [this]() {
+                        return pendingChunks == 0;
+                });
+                job = nullptr;
+                chunkCount = 0;
+                nextChunk = 0;
+
+                return { objects.data(), count };
+        }
+
+private:
+        void work()
+        {
+                auto lock = std::unique_lock<std::mutex>(mutex);
+                for (;;) {
+                        wake.wait(lock, [this]() {
+                                return stopping || nextChunk < chunkCount;
+                        });
+                        if (stopping) {
+                                return;
+                        }
+                        runChunk(lock);
+                }
+        }
+
+        /// claims the next chunk while locked, and builds it unlocked
+        void runChunk(std::unique_lock<std::mutex>& lock)
+        {
+                auto const chunk = nextChunk++;
+                auto const first = objectCount * chunk / chunkCount;
+                auto const last = objectCount * (chunk + 1) / chunkCount;
+                auto const& fn = *job;
+
+                lock.unlock();
+                for (auto i = first; i < last; i++) {
+                        fn(i, objects[i]);
+                }
+                lock.lock();
+
+                if (--pendingChunks == 0) {
+                        done.notify_all();
+                }
+        }
+
+        std::vector<std::thread> workers;
+        std::vector<RenderObjectDef> objects;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        bool stopping = false;
+        ObjectBuildFn const* job = nullptr;
+        size_t objectCount = 0;
+        size_t chunkCount = 0;
+        size_t nextChunk = 0;
+        size_t pendingChunks = 0;
+};
+
+ObjectListBuilderResource makeObjectListBuilder(size_t workerCount)
+{
+        return estd::make_unique<ObjectListBuilder>(workerCount);
+}
+
+RenderObjects buildObjects(ObjectListBuilder& builder, size_t count,
+                           ObjectBuildFn const& build)
+{
+        return builder.build(count, build);
+}
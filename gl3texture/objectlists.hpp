@@ -0,0 +1,36 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+/**
+ * builds lists of render objects on worker threads, for submission
+ * from the GL thread.
+ *
+ * builders run concurrently: they must not touch GL nor a frame
+ * series. handles defined beforehand, interned programs and typed
+ * input declarations are safe to use.
+ */
+class ObjectListBuilder;
+using ObjectListBuilderResource =
+        std::unique_ptr<ObjectListBuilder, std::function<void(ObjectListBuilder*)>>;
+
+/// @param workerCount threads helping the calling thread
+ObjectListBuilderResource makeObjectListBuilder(size_t workerCount);
+
+using ObjectBuildFn = std::function<void(size_t index, RenderObjectDef& object)>;
+
+/**
+ * define count objects, in chunks of consecutive indices spread over
+ * the workers and the calling thread.
+ *
+ * objects keep their storage from one build to the next, so that
+ * assigning their fields does not allocate in the steady state.
+ *
+ * @returns the objects in index order, valid until the next build
+ */
+RenderObjects buildObjects(ObjectListBuilder& builder, size_t count,
+                           ObjectBuildFn const& build);
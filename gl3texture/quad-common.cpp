@@ -15,7 +15,7 @@ size_t define2dQuadIndices(BufferResource const& buffer)
                 count = sizeof data / sizeof data[0];
 
                 glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof data, data,
-                             GL_STREAM_DRAW);
+                             GL_STATIC_DRAW);
         });
 
         return count;
@@ -33,7 +33,7 @@ GLvoid* define2dQuadBuffer(BufferResource const& buffer, float xmin,
                         xmin + width, ymin,
                 };
 
-                glBufferData(GL_ARRAY_BUFFER, sizeof data, data, GL_STREAM_DRAW);
+                glBufferData(GL_ARRAY_BUFFER, sizeof data, data, GL_STATIC_DRAW);
         });
 
         return 0;
@@ -6,6 +6,7 @@
 #include "../gl3companion/gldebug.hpp"
 #include "../gl3companion/glresource_types.hpp"
 #include "../gl3companion/glshaders.hpp"
+#include "../gl3companion/glstate.hpp"
 #include "../gl3companion/gltexturing.hpp"
 
 namespace
@@ -56,15 +57,15 @@ static void define2dTrianglesVertexArray(BufferResource const& indices,
                 GLint texcoordAttrib, BufferResource const& texcoords,
                 GLvoid* texcoordsOffset)
 {
-        glBindBuffer(GL_ARRAY_BUFFER, texcoords.id);
+        glstate::bindBuffer(GL_ARRAY_BUFFER, texcoords.id);
         glVertexAttribPointer(texcoordAttrib, 2, GL_FLOAT, GL_FALSE, 0,
                               texcoordsOffset);
 
-        glBindBuffer(GL_ARRAY_BUFFER, positions.id);
+        glstate::bindBuffer(GL_ARRAY_BUFFER, positions.id);
         glVertexAttribPointer(positionAttrib, 2, GL_FLOAT, GL_FALSE, 0,
                               positionsOffset);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.id);
+        glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.id);
         glEnableVertexAttribArray(texcoordAttrib);
         glEnableVertexAttribArray(positionAttrib);
 }
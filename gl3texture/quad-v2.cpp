@@ -1,4 +1,6 @@
+#include "framepipeline.hpp"
 #include "main_types.hpp"
+#include "objectlists.hpp"
 #include "quad.hpp"
 #include "renderer.hpp"
 
@@ -6,6 +8,7 @@
 #include "../src/hstd.hpp"
 
 #include <cmath>
+#include <mutex>
 
 struct Rect {
         float x;
@@ -45,6 +48,76 @@ static void perlinTexture(uint32_t* pixels, int width, int height, int depth,
         perlinNoisePixelFiller(pixels, width, height);
 }
 
+static constexpr auto POSITION = VertexAttrib<2> { "position" };
+static constexpr auto TEXCOORD = VertexAttrib<2> { "texcoord" };
+static constexpr auto TEX0 = TextureUniform { "tex0" };
+static constexpr auto G_COLOR = VecUniform<4> { "g_color" };
+static constexpr auto TRANSLATION = VecUniform<4> { "translation" };
+static constexpr auto TRANSFORM = MatUniform<4> { "transform" };
+
+/// resources of the quads, defined by the GL thread for the update thread
+struct QuadHandles {
+        ProgramHandle program;
+        MeshHandle mesh;
+        TextureHandle noise;
+};
+
+static std::mutex quadHandlesMutex;
+static QuadHandles quadHandles;
+
+/**
+ * on the update thread, record a grid of quads, each with its own
+ * motion, whose draw list is built by worker threads
+ */
+static void recordQuads(CommandBuffer& commands, uint64_t time_micros)
+{
+        auto handles = QuadHandles {};
+        {
+                auto lock = std::unique_lock<std::mutex>(quadHandlesMutex);
+                handles = quadHandles;
+        }
+        if (!handles.program.defined()) {
+                // shaders still loading
+                return;
+        }
+
+        static auto objectLists = makeObjectListBuilder(2);
+        auto const columnCount = 4;
+
+        auto objects = buildObjects(*objectLists, columnCount * columnCount,
+        [&](size_t index, RenderObjectDef& object) {
+                auto const column = int(index) % columnCount;
+                auto const row = int(index) / columnCount;
+                auto const phase = time_micros / 100000.0 + 0.4 * index;
+
+                object.inputs.attribs = { POSITION(), TEXCOORD() };
+                object.inputs.textures = { TEX0(handles.noise) };
+                object.inputs.floatValues = {
+                        G_COLOR({ 0.2f, 0.4f, (float)(0.1 + 0.3 * sin(phase / 10.0)), 0.0f }),
+                        TRANSLATION({
+                                (float)(-0.6 + 0.4 * column + 0.03 * sin(phase)),
+                                (float)(-0.6 + 0.4 * row),
+                                0.0f,
+                                0.0f
+                        }),
+                        TRANSFORM({
+                                1.0f, 0.0f, 0.0f, 0.0f,
+                                0.0f, (float) (1.0 + 0.35*sin(time_micros/70000.0)), 0.0f, 0.0f,
+                                0.0f, 0.0f, 1.0f, 0.0f,
+                                0.0f, 0.0f, 0.0f, 1.0f
+                        }),
+                };
+                object.mesh = handles.mesh;
+        });
+
+        drawMany(commands, {
+                0*FragmentOperationsDef::CLEAR |
+                0*FragmentOperationsDef::BLEND_PREMULTIPLIED_ALPHA |
+                0*FragmentOperationsDef::DEPTH_TEST,
+                {}
+        }, handles.program, objects);
+}
+
 extern void render_textured_quad_v2(uint64_t time_micros)
 {
         // infrastructure
@@ -155,7 +228,12 @@ extern void render_textured_quad_v2(uint64_t time_micros)
 
         // user code
 
-        static auto output = makeFrameSeries();
+        static auto output = []() {
+                auto output = makeFrameSeries();
+                // relative to the working directory
+                setProgramBinaryDirectory(*output, "program-binaries");
+                return output;
+        }();
 
         auto texture = [](int width, int height, TextureDefFn const& fn) {
                 auto textureDef = TextureDef {};
@@ -167,55 +245,33 @@ extern void render_textured_quad_v2(uint64_t time_micros)
 
         beginFrame(*output);
 
-        drawOne(*output, {
-                0*FragmentOperationsDef::CLEAR |
-                0*FragmentOperationsDef::BLEND_PREMULTIPLIED_ALPHA |
-                0*FragmentOperationsDef::DEPTH_TEST,
-                {}
-        }, {
+        auto const programDef = ProgramDef {
                 HSTD_DFIELD(vertexShader, vertexShaderFromFile("main.vs")),
                 HSTD_DFIELD(fragmentShader, fragmentShaderFromFile("main.fs"))
-        }, {
-                {
-                        { "position", 2 },
-                        { "texcoord", 2 },
-                },
-                {
-                        {
-                                HSTD_DFIELD(name, "tex0"),
-                                HSTD_DFIELD(content, texture(128, 128, perlinTexture))
-                        }
-                },
-                {
-                        {
-                                "g_color", { 0.2, 0.4, (float)(0.1 + 0.3 * sin(time_micros / 1000000.0)), 0.0 }, 0,
-                        },
-                        {
-                                "translation", { (float)(0.15 * sin(time_micros / 100000.0)), 0.0, 0.0, 0.0 }, 0
-                        },
-                        {
-                                "transform", {
-                                        1.0, 0.0, 0.0, 0.0,
-                                        0.0, (float) (1.0 + 0.35*sin(time_micros/70000.0)), 0.0, 0.0,
-                                        0.0, 0.0, 1.0, 0.0,
-                                        0.0, 0.0, 0.0, 1.0
-                                }, 3
-                        },
-                },
-                {},
-
+        };
+        auto handles = QuadHandles {};
+        if (!programDef.vertexShader.source.empty()
+            && !programDef.fragmentShader.source.empty()) {
+                handles.program = defineProgram(*output, intern(programDef));
         }
-        ,
-        quad({
-                HSTD_DFIELD(x, -0.80),
-                HSTD_DFIELD(y, -.80),
-                HSTD_DFIELD(width, 1.6),
-                HSTD_DFIELD(height, 1.6)
+        handles.mesh = defineMesh(*output, quad({
+                HSTD_DFIELD(x, -0.2),
+                HSTD_DFIELD(y, -.2),
+                HSTD_DFIELD(width, 0.4),
+                HSTD_DFIELD(height, 0.4)
         }, {
                 HSTD_DFIELD(x, 0.0),
                 HSTD_DFIELD(y, 0.0),
                 HSTD_DFIELD(width, 1.0),
                 HSTD_DFIELD(height, 1.0)
-        })
-               );
+        }));
+        handles.noise = defineTexture(*output, texture(128, 128, perlinTexture));
+        {
+                auto lock = std::unique_lock<std::mutex>(quadHandlesMutex);
+                quadHandles = handles;
+        }
+
+        // the update thread records the next frame meanwhile
+        static auto pipeline = makeFramePipeline(recordQuads);
+        executeNextFrame(*output, *pipeline, time_micros);
 }
@@ -5,334 +5,1010 @@
 #include "../gl3companion/glinlines.hpp"
 #include "../src/estd.hpp"
 
+#include <cstring>
+#include <mutex>
+#include <tuple>
+
 FrameSeriesResource makeFrameSeries()
 {
-        return estd::make_unique<FrameSeries>();
+        return FrameSeriesResource(new FrameSeries, [](FrameSeries* output) {
+                auto const stats = totalStats(*output);
+                auto const printKind = [](char const* name,
+                FrameSeriesStats::Kind const& kind) {
+                        printf("%s: %ld creations, %ld recycles, %ld evictions, "
+                               "%zu live, %zu bytes\n",
+                               name,
+                               kind.creations,
+                               kind.recycles,
+                               kind.evictions,
+                               kind.liveCount,
+                               kind.bytes);
+                };
+                printf("summary after %llu frames:\n",
+                       (unsigned long long) stats.frame);
+                printKind("programs", stats.programs);
+                printKind("textures", stats.textures);
+                printKind("meshes", stats.meshes);
+                printKind("framebuffers", stats.framebuffers);
+                printf("gl state calls: %ld, redundant: %ld\n",
+                       stats.stateCalls,
+                       stats.redundantStateCalls);
+                delete output;
+        });
 }
 
-namespace
+ProgramInputs::FloatInput constant(ProgramInputs::FloatInput input)
 {
-struct ProgramBindings {
-        std::vector<GLint> textureUniforms;
+        input.constant = true;
+        return input;
+}
 
-        struct ArrayAttrib {
-                GLint id;
-                int componentCount;
-        };
-        std::vector<ArrayAttrib> arrayAttribs;
+ProgramInputs::IntInput constant(ProgramInputs::IntInput input)
+{
+        input.constant = true;
+        return input;
+}
 
-        std::vector<GLint> floatVectorsUniforms;
-        std::vector<GLint> intVectorsUniforms;
-};
+InternedProgramDef intern(ProgramDef const& programDef)
+{
+        static auto internedDefs =
+                std::unordered_multimap<uint64_t, std::weak_ptr<ProgramDef const>> {};
+        // objects may be built on worker threads
+        static std::mutex internedDefsMutex;
+
+        auto const hash = hashOf(programDef);
+        auto lock = std::unique_lock<std::mutex>(internedDefsMutex);
+        auto range = internedDefs.equal_range(hash);
+        for (auto entry = range.first; entry != range.second;) {
+                auto existing = entry->second.lock();
+                if (!existing) {
+                        entry = internedDefs.erase(entry);
+                        continue;
+                }
 
-struct FragmentOperationsScope {
-        FragmentOperationsScope(FragmentOperationsDef const& def)
-        {
-                if (def.flags & FragmentOperationsDef::CLEAR) {
-                        glClearColor (def.clearRGBA[0],
-                                      def.clearRGBA[0],
-                                      def.clearRGBA[0],
-                                      def.clearRGBA[0]);
-                        glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                if (isEqual(*existing, programDef)) {
+                        return { hash, existing };
                 }
+                ++entry;
+        }
+
+        auto def = std::make_shared<ProgramDef const>(programDef);
+        internedDefs.emplace(hash, def);
 
-                if (def.flags &
-                    FragmentOperationsDef::BLEND_PREMULTIPLIED_ALPHA) {
-                        glEnable(GL_BLEND);
-                        glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-                        glDisable (GL_DEPTH_TEST);
-                        glDepthMask (GL_FALSE);
+        return { hash, def };
+}
+
+namespace
+{
+/**
+ * set the complete fragment state of a pass through the state
+ * cache. It is left in place for the next pass to change.
+ */
+void applyFragmentOperations(FragmentOperationsDef const& def)
+{
+        if (def.flags & FragmentOperationsDef::CLEAR) {
+                glClearColor (def.clearRGBA[0],
+                              def.clearRGBA[0],
+                              def.clearRGBA[0],
+                              def.clearRGBA[0]);
+                glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+
+        auto const blend = (def.flags
+                            & FragmentOperationsDef::BLEND_PREMULTIPLIED_ALPHA) != 0;
+        auto const depthTest = (def.flags & FragmentOperationsDef::DEPTH_TEST) != 0;
+
+        glstate::setCapability(GL_BLEND, blend);
+        if (blend) {
+                glstate::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        glstate::setCapability(GL_DEPTH_TEST, depthTest);
+        glstate::setDepthMask(depthTest);
+}
+}
+
+/// rows and columns of a float attribute type, fed column by column
+static
+bool attributeShape(GLenum type, int& rows, int& columns)
+{
+        switch (type) {
+        case GL_FLOAT: rows = 1; columns = 1; break;
+        case GL_FLOAT_VEC2: rows = 2; columns = 1; break;
+        case GL_FLOAT_VEC3: rows = 3; columns = 1; break;
+        case GL_FLOAT_VEC4: rows = 4; columns = 1; break;
+        case GL_FLOAT_MAT2: rows = 2; columns = 2; break;
+        case GL_FLOAT_MAT3: rows = 3; columns = 3; break;
+        case GL_FLOAT_MAT4: rows = 4; columns = 4; break;
+        case GL_FLOAT_MAT2x3: rows = 3; columns = 2; break;
+        case GL_FLOAT_MAT2x4: rows = 4; columns = 2; break;
+        case GL_FLOAT_MAT3x2: rows = 2; columns = 3; break;
+        case GL_FLOAT_MAT3x4: rows = 4; columns = 3; break;
+        case GL_FLOAT_MAT4x2: rows = 2; columns = 4; break;
+        case GL_FLOAT_MAT4x3: rows = 3; columns = 4; break;
+        default:
+                return false;
+        }
+        return true;
+}
+
+/// components of an int or bool uniform of type, 0 for other types
+static
+size_t intUniformWidth(GLenum type)
+{
+        switch (type) {
+        case GL_INT: case GL_BOOL: return 1;
+        case GL_INT_VEC2: case GL_BOOL_VEC2: return 2;
+        case GL_INT_VEC3: case GL_BOOL_VEC3: return 3;
+        case GL_INT_VEC4: case GL_BOOL_VEC4: return 4;
+        }
+        return 0;
+}
+
+/**
+ * whether count values fill the uniform name, as declared by the
+ * program. types of an unknown shape are not checked.
+ */
+static
+bool fillsUniform(ShaderVariables const& uniforms,
+                  std::string const& name,
+                  size_t count,
+                  bool isInt)
+{
+        auto const uniform = uniforms.find(name);
+        if (uniform == std::end(uniforms)) {
+                return true;
+        }
+
+        auto const type = uniform->second.type;
+        auto expected = intUniformWidth(type);
+        auto rows = 0;
+        auto columns = 0;
+        if (!isInt && attributeShape(type, rows, columns)) {
+                expected = size_t(rows * columns);
+        }
+        if (expected == 0 || count == expected) {
+                return true;
+        }
+
+        printf("%s holds %lu values, given %lu\n", name.c_str(), expected, count);
+        return false;
+}
+
+/// @returns false when the input is not declared in a uniform block
+static
+bool addBlockField(ProgramBindings& bindings,
+                   ProgramReflection const& reflection,
+                   std::string const& name,
+                   bool isInt,
+                   size_t inputIndex)
+{
+        for (auto const& block : reflection.uniformBlocks) {
+                auto member = block.members.find(name);
+                if (member == std::end(block.members)) {
+                        continue;
                 }
 
-                if (def.flags & FragmentOperationsDef::DEPTH_TEST) {
-                        glDepthMask (GL_TRUE);
-                        glEnable(GL_DEPTH_TEST);
+                auto& blocks = bindings.uniformBlocks;
+                auto slot = std::find_if(std::begin(blocks), std::end(blocks),
+                [&block](ProgramBindings::UniformBlockBinding const& binding) {
+                        return binding.binding == block.index;
+                }) - std::begin(blocks);
+                if (size_t(slot) == blocks.size()) {
+                        blocks.push_back({ block.index, size_t(block.dataSize) });
                 }
+
+                bindings.blockFields.push_back({
+                        size_t(slot), isInt, inputIndex, member->second
+                });
+                return true;
         }
+        return false;
+}
 
-        ~FragmentOperationsScope()
-        {
-                glDisable(GL_BLEND);
-                glDepthMask (GL_FALSE);
-                glDisable(GL_DEPTH_TEST);
+/// bindings of the inputs, resolved on the first draw with their schema
+/// glUniform* call for values of this shape, matrices given row by row
+static
+ProgramBindings::FloatUploadFn floatUploadOf(int rows, int columns)
+{
+        switch ((rows & 0xff) | ((columns & 0xff) << 8)) {
+        case 0x0101:
+                return [](GLint id, GLfloat const* values) { glUniform1fv(id, 1, values); };
+        case 0x0201:
+                return [](GLint id, GLfloat const* values) { glUniform2fv(id, 1, values); };
+        case 0x0301:
+                return [](GLint id, GLfloat const* values) { glUniform3fv(id, 1, values); };
+        case 0x0401:
+                return [](GLint id, GLfloat const* values) { glUniform4fv(id, 1, values); };
+        case 0x0202:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix2fv(id, 1, GL_TRUE, values); };
+        case 0x0303:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix3fv(id, 1, GL_TRUE, values); };
+        case 0x0404:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix4fv(id, 1, GL_TRUE, values); };
+        case 0x0402:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix4x2fv(id, 1, GL_TRUE, values); };
+        case 0x0302:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix3x2fv(id, 1, GL_TRUE, values); };
+        case 0x0403:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix4x3fv(id, 1, GL_TRUE, values); };
+        case 0x0203:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix2x3fv(id, 1, GL_TRUE, values); };
+        case 0x0304:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix3x4fv(id, 1, GL_TRUE, values); };
+        case 0x0204:
+                return [](GLint id, GLfloat const* values) { glUniformMatrix2x4fv(id, 1, GL_TRUE, values); };
         }
-};
+        return nullptr;
 }
 
-ProgramBindings programBindings(FrameSeries::ShaderProgramMaterials const&
-                                program,
-                                ProgramInputs const& inputs)
+static
+ProgramBindings::IntUploadFn intUploadOf(size_t width)
+{
+        switch (width) {
+        case 1:
+                return [](GLint id, GLint const* values) { glUniform1iv(id, 1, values); };
+        case 2:
+                return [](GLint id, GLint const* values) { glUniform2iv(id, 1, values); };
+        case 3:
+                return [](GLint id, GLint const* values) { glUniform3iv(id, 1, values); };
+        case 4:
+                return [](GLint id, GLint const* values) { glUniform4iv(id, 1, values); };
+        }
+        return nullptr;
+}
+
+/// the shadow of uniform id, added when the first schema binds it
+template <typename T>
+static
+size_t shadowOf(std::vector<ProgramReflection::UniformShadow>& shadows,
+                std::vector<T>& shadowValues,
+                GLint id,
+                size_t count)
+{
+        for (size_t i = 0; i < shadows.size(); i++) {
+                if (shadows[i].id == id) {
+                        return i;
+                }
+        }
+        shadows.push_back({ id, shadowValues.size(), count, false });
+        shadowValues.resize(shadowValues.size() + count);
+        return shadows.size() - 1;
+}
+
+static
+ProgramBindings const& programBindings(FrameSeries::ShaderProgramMaterials const&
+                                       program,
+                                       ProgramInputs const& inputs)
 {
+        auto& reflection = *program.reflection;
+
+        auto const hash = schemaHashOf(inputs);
+        auto range = reflection.schemas.equal_range(hash);
+        for (auto entry = range.first; entry != range.second; ++entry) {
+                if (isSameSchema(entry->second.schema, inputs)) {
+                        return entry->second.bindings;
+                }
+        }
+
         auto bindings = ProgramBindings {};
 
         std::transform(std::begin(inputs.textures),
                        std::end(inputs.textures),
                        std::back_inserter(bindings.textureUniforms),
-        [&program](ProgramInputs::TextureInput const& element) {
-                return glGetUniformLocation(program.programId, element.name.c_str());
+        [&reflection](ProgramInputs::TextureInput const& element) {
+                return locationOf(reflection.uniforms, element.name);
         });
+        for (auto uniformId : bindings.textureUniforms) {
+                bindings.textureShadows.push_back(uniformId < 0 ? 0 : shadowOf(
+                                reflection.intShadows, reflection.intShadowValues,
+                                uniformId, 1));
+        }
 
         std::transform(std::begin(inputs.attribs),
                        std::end(inputs.attribs),
                        std::back_inserter(bindings.arrayAttribs),
-                       [&program](ProgramInputs::AttribArrayInput const& element) ->
+                       [&reflection](ProgramInputs::AttribArrayInput const& element) ->
         ProgramBindings::ArrayAttrib {
                 return {
-                        glGetAttribLocation(program.programId, element.name.c_str()),
+                        locationOf(reflection.attributes, element.name),
                         element.componentCount
                 };
         });
 
-        std::transform(std::begin(inputs.floatValues),
-                       std::end(inputs.floatValues),
-                       std::back_inserter(bindings.floatVectorsUniforms),
-        [&program](ProgramInputs::FloatInput const& element) {
-                return glGetUniformLocation(program.programId, element.name.c_str());
-        });
+        for (size_t i = 0; i < inputs.floatValues.size(); i++) {
+                auto const& name = inputs.floatValues[i].name;
+                auto uniformId = locationOf(reflection.uniforms, name);
+                if (uniformId >= 0) {
+                        auto const& values = inputs.floatValues[i].values;
+                        if (!fillsUniform(reflection.uniforms, name, values.size(), false)) {
+                                continue;
+                        }
+                        auto const rows = 1 + inputs.floatValues[i].last_row;
+                        auto const upload = floatUploadOf(rows, values.size() / rows);
+                        if (!upload) {
+                                printf("invalid number of float inputs: %lu, rows: %d\n",
+                                       values.size(), rows);
+                                continue;
+                        }
+                        auto const shadow = shadowOf(reflection.floatShadows,
+                                                     reflection.floatShadowValues,
+                                                     uniformId, values.size());
+                        bindings.floatUploads.push_back({ uniformId, i, upload, shadow });
+                        continue;
+                }
+                if (addBlockField(bindings, reflection, name, false, i)) {
+                        continue;
+                }
+
+                // declared as a vertex shader input: fed per instance
+                auto attribute = reflection.attributes.find(name);
+                if (attribute == std::end(reflection.attributes)) {
+                        continue;
+                }
+                auto instanceAttrib = ProgramBindings::InstanceAttrib {};
+                if (!attributeShape(attribute->second.type,
+                                    instanceAttrib.rows,
+                                    instanceAttrib.columns)) {
+                        printf("unsupported per instance input type for %s\n",
+                               name.c_str());
+                        continue;
+                }
+                instanceAttrib.id = attribute->second.location;
+                instanceAttrib.floatInputIndex = i;
+                instanceAttrib.offset = bindings.instanceStride;
+                bindings.instanceStride += instanceAttrib.rows * instanceAttrib.columns;
+                bindings.instanceAttribs.push_back(instanceAttrib);
+        }
 
-        std::transform(std::begin(inputs.intValues),
-                       std::end(inputs.intValues),
-                       std::back_inserter(bindings.intVectorsUniforms),
-        [&program](ProgramInputs::IntInput const& element) {
-                return glGetUniformLocation(program.programId, element.name.c_str());
+        for (size_t i = 0; i < inputs.intValues.size(); i++) {
+                auto const& name = inputs.intValues[i].name;
+                auto uniformId = locationOf(reflection.uniforms, name);
+                if (uniformId < 0) {
+                        addBlockField(bindings, reflection, name, true, i);
+                        continue;
+                }
+                auto const width = inputs.intValues[i].values.size();
+                if (!fillsUniform(reflection.uniforms, name, width, true)) {
+                        continue;
+                }
+                auto const upload = intUploadOf(width);
+                if (!upload) {
+                        printf("invalid number of int inputs: %lu\n", width);
+                        continue;
+                }
+                auto const shadow = shadowOf(reflection.intShadows,
+                                             reflection.intShadowValues,
+                                             uniformId, width);
+                bindings.intUploads.push_back({ uniformId, i, upload, shadow });
+        }
+
+        auto entry = reflection.schemas.emplace(hash, ProgramReflection::SchemaBindings {
+                schemaOf(inputs), bindings
         });
+        return entry->second.bindings;
+}
 
+static
+bool isDefined(InternedProgramDef const& programDef)
+{
+        return !programDef.def->vertexShader.source.empty()
+               && !programDef.def->fragmentShader.source.empty();
+}
 
-        return bindings;
-};
+static
+FrameSeries::MeshMaterials objectMesh(FrameSeries& output,
+                                      RenderObjectDef const& object)
+{
+        if (object.mesh.defined()) {
+                return output.mesh(object.mesh);
+        }
+        return output.mesh(object.geometry);
+}
 
+/**
+ * vertex array of the mesh for these attributes, configured on first
+ * use. per instance attributes are pointed at their data on each draw.
+ */
 static
-void innerDrawOne(FrameSeries& output,
-                  ProgramDef programDef,
-                  ProgramInputs inputs,
-                  GeometryDef geometryDef)
+GLuint vertexArray(FrameSeries::MeshMaterials const& mesh,
+                   ProgramBindings const& vars)
 {
-        // define and draw the content of the frame
+        auto const& attribs = vars.arrayAttribs;
+        auto const& instanceAttribs = vars.instanceAttribs;
 
-        if (programDef.vertexShader.source.empty()
-            || programDef.fragmentShader.source.empty()) {
-                return;
+        auto const isSameAttrib = [](ProgramBindings::ArrayAttrib const& a,
+        ProgramBindings::ArrayAttrib const& b) {
+                return a.id == b.id && a.componentCount == b.componentCount;
+        };
+        auto const isSameInstanceAttrib = [](ProgramBindings::InstanceAttrib const& a,
+        ProgramBindings::InstanceAttrib const& b) {
+                return a.id == b.id
+                       && a.rows == b.rows
+                       && a.columns == b.columns
+                       && a.offset == b.offset;
+        };
+
+        auto& layouts = mesh.vertexArrays->layouts;
+        if (mesh.vertexArrays->storageGeneration != mesh.storageGeneration) {
+                // the arena moved to larger buffers
+                layouts.clear();
+                mesh.vertexArrays->storageGeneration = mesh.storageGeneration;
+        }
+        for (auto const& layout : layouts) {
+                if (layout.attribs.size() == attribs.size()
+                    && std::equal(std::begin(attribs), std::end(attribs),
+                                  std::begin(layout.attribs), isSameAttrib)
+                    && layout.instanceAttribs.size() == instanceAttribs.size()
+                    && std::equal(std::begin(instanceAttribs), std::end(instanceAttribs),
+                                  std::begin(layout.instanceAttribs), isSameInstanceAttrib)) {
+                        return layout.vertexArray.id;
+                }
         }
 
-        auto const& program = output.program(programDef);
-        glUseProgram(program.programId);
-        {
-                auto vars = programBindings(program, inputs);
+        layouts.emplace_back();
+        auto& layout = layouts.back();
+        layout.attribs = attribs;
+        layout.instanceAttribs = instanceAttribs;
 
-                auto bindTextureUnits = [&inputs,&vars,&output]() {
-                        // and return the active texture targets
-                        auto textureUnits = std::vector<std::pair<GLenum,GLenum>> {};
+        glstate::bindVertexArray(layout.vertexArray.id);
+        {
+                size_t i = 0;
+                glstate::bindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+                for (auto attrib : attribs) {
+                        auto const arrayIndex = i++;
+                        if (attrib.id < 0 || arrayIndex >= mesh.arrayCount) {
+                                continue;
+                        }
 
-                        auto i = 0;
-                        for (auto& textureInput : inputs.textures) {
-                                auto unitIndex = i;
-                                auto uniformId = vars.textureUniforms[i];
-                                i++;
+                        auto const offset = mesh.arrays[arrayIndex].offset;
+                        glVertexAttribPointer(attrib.id, attrib.componentCount, GL_FLOAT, GL_FALSE, 0,
+                                              reinterpret_cast<GLvoid*> (offset));
+                        glEnableVertexAttribArray(attrib.id);
+                }
 
-                                if (uniformId < 0) {
-                                        continue;
-                                }
-                                auto const& texture = output.texture(textureInput.content);
-                                if (texture.target == 0) {
-                                        printf("texture target is 0, ignoring texture\n");
-                                        continue;
-                                }
-                                auto unit = GL_TEXTURE0 + unitIndex;
-                                textureUnits.emplace_back(unit, texture.target);
-                                glActiveTexture(unit);
-                                glBindTexture(texture.target, texture.textureId);
-                                glUniform1i(uniformId, unitIndex);
+                for (auto attrib : instanceAttribs) {
+                        for (int column = 0; column < attrib.columns; column++) {
+                                auto const location = attrib.id + column;
+                                glVertexAttribDivisor(location, 1);
+                                glEnableVertexAttribArray(location);
                         }
+                }
 
-                        OGL_TRACE;
+                glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indicesBuffer);
+        }
+        OGL_TRACE;
 
-                        return textureUnits;
-                };
+        return layout.vertexArray.id;
+}
 
-                auto unbindTextureUnits = [](std::vector<std::pair<GLenum,GLenum>> const&
-                activeTextureUnits) {
-                        // unbind
-                        for (auto pair : activeTextureUnits) {
-                                glActiveTexture(pair.first);
-                                glBindTexture(pair.second, 0);
-                        }
-                        glActiveTexture(GL_TEXTURE0);
-                };
+/// per instance attributes of the bound vertex array, read from offset
+static
+void pointInstanceAttribs(ProgramBindings const& vars,
+                          GLuint buffer,
+                          size_t offset)
+{
+        auto const stride = GLsizei(sizeof(float) * vars.instanceStride);
+        glstate::bindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (auto attrib : vars.instanceAttribs) {
+                for (int column = 0; column < attrib.columns; column++) {
+                        auto const location = attrib.id + column;
+                        auto const columnOffset = offset + sizeof(float)
+                                                  * (attrib.offset + column * attrib.rows);
+                        glVertexAttribPointer(location, attrib.rows, GL_FLOAT, GL_FALSE,
+                                              stride,
+                                              reinterpret_cast<GLvoid*> (columnOffset));
+                }
+        }
+}
 
-                auto bindFloatUniforms = [&inputs,&vars]() {
-                        auto i = 0;
-                        for (auto& floatInput : inputs.floatValues) {
-                                auto uniformId = vars.floatVectorsUniforms[i];
-                                i++;
+/**
+ * record values as the last ones uploaded to the uniform of shadow.
+ *
+ * @returns false when they already were, and need no upload
+ */
+template <typename T>
+static
+bool updateShadow(ProgramReflection::UniformShadow& shadow,
+                  std::vector<T>& shadowValues,
+                  T const* values,
+                  size_t count)
+{
+        // the same location may be given values of another size by another schema
+        if (count != shadow.count) {
+                shadow.uploaded = false;
+                return true;
+        }
+        auto const shadowed = shadowValues.data() + shadow.offset;
+        if (shadow.uploaded && std::memcmp(shadowed, values, count * sizeof(T)) == 0) {
+                return false;
+        }
+        std::memcpy(shadowed, values, count * sizeof(T));
+        shadow.uploaded = true;
+        return true;
+}
 
-                                if (uniformId < 0) {
-                                        continue;
-                                }
+static
+void bindTextureInputs(FrameSeries& output,
+                       ProgramReflection& reflection,
+                       ProgramInputs const& inputs,
+                       ProgramBindings const& vars)
+{
+        auto i = 0;
+        for (auto& textureInput : inputs.textures) {
+                auto unitIndex = i;
+                auto uniformId = vars.textureUniforms[i];
+                i++;
+
+                if (uniformId < 0) {
+                        continue;
+                }
 
-                                auto const& values = floatInput.values;
-                                auto const width  = values.size();
-                                auto const last_row = floatInput.last_row;
-                                if (last_row == 0) {
-                                        void (*set_many_vecn)(GLint location, GLsizei count,
-                                                              const GLfloat *value) = nullptr;
-
-                                        switch (width) {
-                                        case 4:
-                                                set_many_vecn = glUniform4fv;
-                                                break;
-                                        case 3:
-                                                set_many_vecn = glUniform3fv;
-                                                break;
-                                        case 2:
-                                                set_many_vecn = glUniform2fv;
-                                                break;
-                                        case 1:
-                                                set_many_vecn = glUniform1fv;
-                                                break;
-                                        }
+                // textures get created on the active unit
+                auto unit = GL_TEXTURE0 + unitIndex;
+                glstate::activeTexture(unit);
 
-                                        if (!set_many_vecn) {
-                                                printf("invalid number of float inputs: %lu\n", width);
-                                        }
+                auto const& texture = textureInput.texture.defined()
+                                      ? output.texture(textureInput.texture)
+                                      : output.texture(textureInput.content);
+                if (texture.target == 0) {
+                        printf("texture target is 0, ignoring texture\n");
+                        continue;
+                }
+                glstate::bindTexture(texture.target, texture.textureId);
+                auto const unitValue = int32_t(unitIndex);
+                if (updateShadow(reflection.intShadows[vars.textureShadows[unitIndex]],
+                                 reflection.intShadowValues, &unitValue, 1)) {
+                        glUniform1i(uniformId, unitIndex);
+                }
+        }
 
-                                        set_many_vecn(uniformId, 1, &values.front());
-                                } else {
-                                        void (*set_many_matnm)(GLint location, GLsizei count, GLboolean tranpose,
-                                                               const GLfloat* value) = nullptr;
-
-                                        auto const rows = 1+last_row;
-                                        auto const columns = width / rows;
-
-                                        auto dim = (rows & 0xff) | ((columns & 0xff) << 8);
-                                        switch(dim) {
-                                        case 0x0202:
-                                                set_many_matnm = glUniformMatrix2fv;
-                                                break;
-                                        case 0x0303:
-                                                set_many_matnm = glUniformMatrix3fv;
-                                                break;
-                                        case 0x0404:
-                                                set_many_matnm = glUniformMatrix4fv;
-                                                break;
-                                        case 0x0402:
-                                                set_many_matnm = glUniformMatrix4x2fv;
-                                                break;
-                                        case 0x0302:
-                                                set_many_matnm = glUniformMatrix3x2fv;
-                                                break;
-                                        case 0x0403:
-                                                set_many_matnm = glUniformMatrix4x3fv;
-                                                break;
-                                        case 0x0203:
-                                                set_many_matnm = glUniformMatrix2x3fv;
-                                                break;
-                                        case 0x0304:
-                                                set_many_matnm = glUniformMatrix3x4fv;
-                                                break;
-                                        case 0x0204:
-                                                set_many_matnm = glUniformMatrix2x4fv;
-                                                break;
+        OGL_TRACE;
+}
 
-                                        }
+/// upload the values which differ from the ones the program already has
+static
+void bindFloatUniforms(ProgramReflection& reflection,
+                       ProgramInputs const& inputs,
+                       ProgramBindings const& vars)
+{
+        for (auto const& uniform : vars.floatUploads) {
+                auto const& values = inputs.floatValues[uniform.inputIndex].values;
+                if (updateShadow(reflection.floatShadows[uniform.shadow],
+                                 reflection.floatShadowValues,
+                                 values.data(), values.size())) {
+                        uniform.upload(uniform.id, values.data());
+                }
+        }
+        OGL_TRACE;
+}
 
-                                        if (!set_many_matnm) {
-                                                printf("invalid number of float inputs: %lu, rows: %u\n", width, 1+last_row);
-                                        }
+static
+void bindIntUniforms(ProgramReflection& reflection,
+                     ProgramInputs const& inputs,
+                     ProgramBindings const& vars)
+{
+        for (auto const& uniform : vars.intUploads) {
+                auto const& values = inputs.intValues[uniform.inputIndex].values;
+                if (updateShadow(reflection.intShadows[uniform.shadow],
+                                 reflection.intShadowValues,
+                                 values.data(), values.size())) {
+                        uniform.upload(uniform.id, values.data());
+                }
+        }
+        OGL_TRACE;
+}
 
-                                        set_many_matnm(uniformId, 1, GL_TRUE, &values.front());
-                                }
-                                OGL_TRACE;
+/// write the inputs declared in uniform blocks, std140
+static
+void stageUniformBlocks(UniformBufferRing& ring,
+                        ProgramInputs const& inputs,
+                        ProgramBindings const& vars,
+                        std::vector<size_t>& blockOffsets)
+{
+        auto const firstBlock = blockOffsets.size();
+        for (auto const& block : vars.uniformBlocks) {
+                blockOffsets.push_back(ring.stage(block.dataSize));
+        }
+
+        for (auto const& field : vars.blockFields) {
+                auto const data = ring.staged(blockOffsets[firstBlock + field.blockSlot])
+                                  + field.member.offset;
+
+                if (field.isInt) {
+                        auto const& values = inputs.intValues[field.inputIndex].values;
+                        std::copy(std::begin(values), std::end(values),
+                                  reinterpret_cast<int32_t*> (data));
+                        continue;
+                }
+
+                auto const& input = inputs.floatValues[field.inputIndex];
+                auto const& values = input.values;
+                if (input.last_row == 0) {
+                        std::copy(std::begin(values), std::end(values),
+                                  reinterpret_cast<float*> (data));
+                        continue;
+                }
+
+                // matrices are given row by row
+                auto const rows = size_t(1 + input.last_row);
+                auto const columns = values.size() / rows;
+                auto const& member = field.member;
+                for (size_t row = 0; row < rows; row++) {
+                        for (size_t column = 0; column < columns; column++) {
+                                auto const major = member.isRowMajor ? row : column;
+                                auto const minor = member.isRowMajor ? column : row;
+                                auto const element = data + major * member.matrixStride
+                                                     + minor * sizeof(float);
+                                *reinterpret_cast<float*> (element) =
+                                        values[row * columns + column];
                         }
-                };
+                }
+        }
+}
 
-                auto bindIntUniforms = [&inputs,&vars]() {
-                        auto i = 0;
-                        for (auto& intInput : inputs.intValues) {
-                                auto uniformId = vars.intVectorsUniforms[i];
-                                i++;
+static
+void bindUniformBlocks(UniformBufferRing const& ring,
+                       size_t base,
+                       ProgramBindings const& vars,
+                       size_t const blockOffsets[])
+{
+        size_t i = 0;
+        for (auto const& block : vars.uniformBlocks) {
+                glstate::bindBufferRange(GL_UNIFORM_BUFFER, block.binding, ring.id(),
+                                         base + blockOffsets[i], block.dataSize);
+                i++;
+        }
+}
 
-                                if (uniformId < 0) {
-                                        continue;
+/// append the values of per instance inputs, column by column
+static
+void appendInstance(std::vector<float>& data,
+                    ProgramInputs const& inputs,
+                    ProgramBindings const& vars)
+{
+        for (auto const& attrib : vars.instanceAttribs) {
+                auto const& input = inputs.floatValues[attrib.floatInputIndex];
+                auto const& values = input.values;
+                auto const inputRows = size_t(1 + input.last_row);
+                auto const inputColumns = values.size() / inputRows;
+
+                for (int column = 0; column < attrib.columns; column++) {
+                        for (int row = 0; row < attrib.rows; row++) {
+                                auto value = 0.0f;
+                                if (input.last_row == 0) {
+                                        auto const index = size_t(column * attrib.rows + row);
+                                        if (index < values.size()) {
+                                                value = values[index];
+                                        }
+                                } else if (size_t(row) < inputRows
+                                           && size_t(column) < inputColumns) {
+                                        // matrices are given row by row
+                                        value = values[row * inputColumns + column];
                                 }
+                                data.push_back(value);
+                        }
+                }
+        }
+}
 
-                                auto const& values = intInput.values;
-                                auto const width  = values.size();
-
-                                void (*set_many_vecn)(GLint location, GLsizei count,
-                                                      const GLint *value) = nullptr;
-
-                                switch (width) {
-                                case 4:
-                                        set_many_vecn = glUniform4iv;
-                                        break;
-                                case 3:
-                                        set_many_vecn = glUniform3iv;
-                                        break;
-                                case 2:
-                                        set_many_vecn = glUniform2iv;
-                                        break;
-                                case 1:
-                                        set_many_vecn = glUniform1iv;
-                                        break;
-                                }
+/// draw the mesh once per instance, with their per instance inputs
+static
+void drawInstances(FrameSeries& output,
+                   ProgramBindings const& vars,
+                   FrameSeries::MeshMaterials const& mesh,
+                   ProgramInputs const* const instances[],
+                   size_t instanceCount)
+{
+        if (vars.instanceAttribs.empty()) {
+                glstate::bindVertexArray(vertexArray(mesh, vars));
+                for (size_t i = 0; i < instanceCount; i++) {
+                        glDrawElements(GL_TRIANGLES,
+                                       mesh.indicesCount,
+                                       GL_UNSIGNED_INT,
+                                       reinterpret_cast<GLvoid*> (mesh.indicesOffset));
+                }
+                OGL_TRACE;
+                return;
+        }
 
-                                if (!set_many_vecn) {
-                                        printf("invalid number of int inputs: %lu\n", width);
-                                }
+        auto& instanceData = output.drawScratch().instanceData;
+        instanceData.clear();
+        for (size_t i = 0; i < instanceCount; i++) {
+                appendInstance(instanceData, *instances[i], vars);
+        }
 
-                                set_many_vecn(uniformId, 1, &values.front());
-                                OGL_TRACE;
-                        }
-                };
+        // streamed rather than respecified, so that draws do not reallocate
+        auto& stream = output.instanceStream();
+        auto const offset = stream.write(&instanceData.front(),
+                                         sizeof(float) * instanceData.size());
+
+        glstate::bindVertexArray(vertexArray(mesh, vars));
+        pointInstanceAttribs(vars, stream.buffer(), offset);
+        glDrawElementsInstanced(GL_TRIANGLES,
+                                mesh.indicesCount,
+                                GL_UNSIGNED_INT,
+                                reinterpret_cast<GLvoid*> (mesh.indicesOffset),
+                                instanceCount);
+        OGL_TRACE;
+}
 
-                auto activeTextureUnits = bindTextureUnits();
-                bindFloatUniforms();
-                bindIntUniforms();
+static
+void innerDrawOne(FrameSeries& output,
+                  FrameSeries::ShaderProgramMaterials const& program,
+                  ProgramInputs const& inputs,
+                  FrameSeries::MeshMaterials const& mesh)
+{
+        // define and draw the content of the frame
 
-                auto const& mesh = output.mesh(geometryDef);
+        if (!program.programId || !mesh.vertexArrays) {
+                // stale handles
+                return;
+        }
 
-                // draw here
-                glBindVertexArray(mesh.vertexArray);
-                {
-                        auto& vertexAttribVars = vars.arrayAttribs;
+        glstate::useProgram(program.programId);
 
-                        int i = 0;
-                        for (auto attrib : vertexAttribVars) {
+        auto const& vars = programBindings(program, inputs);
+        auto& reflection = *program.reflection;
+        bindTextureInputs(output, reflection, inputs, vars);
+        bindFloatUniforms(reflection, inputs, vars);
+        bindIntUniforms(reflection, inputs, vars);
 
-                                glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffers[i]);
-                                glVertexAttribPointer(attrib.id, attrib.componentCount, GL_FLOAT, GL_FALSE, 0,
-                                                      0);
+        if (!vars.uniformBlocks.empty()) {
+                auto& blockOffsets = output.drawScratch().blockOffsets;
+                blockOffsets.clear();
 
-                                glEnableVertexAttribArray(attrib.id);
-                                i++;
-                        }
+                auto& ring = output.uniformRing();
+                stageUniformBlocks(ring, inputs, vars, blockOffsets);
+                bindUniformBlocks(ring, ring.flush(), vars, &blockOffsets.front());
+        }
 
-                        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indicesBuffer);
-                        glDrawElements(GL_TRIANGLES,
-                                       mesh.indicesCount,
-                                       GL_UNSIGNED_INT,
-                                       0);
+        ProgramInputs const* const instances[] = { &inputs };
+        drawInstances(output, vars, mesh, instances, 1);
+}
 
-                        for (auto attrib : vertexAttribVars) {
-                                glDisableVertexAttribArray(attrib.id);
-                        }
+/// identity of the textures of some inputs, for sorting
+static
+uint64_t texturesKeyOf(ProgramInputs const& inputs)
+{
+        auto key = FNV1A_BASIS;
+        for (auto const& input : inputs.textures) {
+                if (input.texture.defined()) {
+                        key = hashValue(input.texture.slot, key);
+                        key = hashValue(input.texture.generation, key);
+                } else {
+                        key = hashValue(hashOf(input.content), key);
                 }
-                glBindVertexArray(0);
+        }
+        return key;
+}
 
-                unbindTextureUnits(activeTextureUnits);
-                OGL_TRACE;
+static
+bool haveSameTextures(ProgramInputs const& a, ProgramInputs const& b)
+{
+        return std::equal(std::begin(a.textures), std::end(a.textures),
+                          std::begin(b.textures),
+        [](ProgramInputs::TextureInput const& x, ProgramInputs::TextureInput const& y) {
+                if (x.texture.defined() || y.texture.defined()) {
+                        return x.texture.slot == y.texture.slot
+                               && x.texture.generation == y.texture.generation;
+                }
+                return isEqual(x.content, y.content);
+        });
+}
+
+/// same values for everything that is not fed per instance
+static
+bool haveSameUniforms(ProgramInputs const& a, ProgramInputs const& b,
+                      ProgramBindings const& vars)
+{
+        for (size_t i = 0; i < a.floatValues.size(); i++) {
+                auto const isPerInstance = std::any_of(std::begin(vars.instanceAttribs),
+                                                       std::end(vars.instanceAttribs),
+                [i](ProgramBindings::InstanceAttrib const& attrib) {
+                        return attrib.floatInputIndex == i;
+                });
+                if (isPerInstance) {
+                        continue;
+                }
+                if (a.floatValues[i].values != b.floatValues[i].values
+                    || a.floatValues[i].last_row != b.floatValues[i].last_row) {
+                        return false;
+                }
         }
-        glUseProgram(0);
-};
+        for (size_t i = 0; i < a.intValues.size(); i++) {
+                if (a.intValues[i].values != b.intValues[i].values) {
+                        return false;
+                }
+        }
+        return true;
+}
 
+/**
+ * draw objects sharing a program.
+ *
+ * objects are sorted by bindings, textures and mesh when the fragment
+ * operations do not depend on submission order. consecutive objects
+ * differing only in their per instance inputs are drawn as one
+ * instanced draw. the uniform blocks of all draws are written at once.
+ */
 static
-void innerDrawMany(FrameSeries& output, ProgramDef program,
-                   std::vector<RenderObjectDef> objects)
+void innerDrawMany(FrameSeries& output,
+                   FrameSeries::ShaderProgramMaterials const& program,
+                   FragmentOperationsDef const& fragmentOperations,
+                   RenderObjects objects)
 {
+        if (!program.programId) {
+                return;
+        }
+
+        using DrawItem = FrameSeries::DrawScratch::Item;
+
+        auto& scratch = output.drawScratch();
+        auto& items = scratch.items;
+        items.clear();
         for (auto const& object : objects) {
-                innerDrawOne(output, program, object.inputs, object.geometry);
+                auto mesh = objectMesh(output, object);
+                if (!mesh.vertexArrays) {
+                        // stale handles
+                        continue;
+                }
+                items.push_back({
+                        &object.inputs,
+                        &programBindings(program, object.inputs),
+                        mesh,
+                        texturesKeyOf(object.inputs),
+                });
+        }
+
+        auto const reorderable =
+                !(fragmentOperations.flags & FragmentOperationsDef::BLEND_PREMULTIPLIED_ALPHA)
+                && (fragmentOperations.flags & FragmentOperationsDef::DEPTH_TEST);
+        if (reorderable) {
+                auto const keyOf = [](DrawItem const& item) {
+                        return std::make_tuple(reinterpret_cast<uintptr_t> (item.bindings),
+                                               item.texturesKey,
+                                               reinterpret_cast<uintptr_t> (item.mesh.vertexArrays));
+                };
+                std::stable_sort(std::begin(items), std::end(items),
+                [&keyOf](DrawItem const& a, DrawItem const& b) {
+                        return keyOf(a) < keyOf(b);
+                });
         }
 
+        auto const isSameBatch = [](DrawItem const& a, DrawItem const& b) {
+                return a.bindings == b.bindings
+                       && a.mesh.vertexArrays == b.mesh.vertexArrays
+                       && a.texturesKey == b.texturesKey
+                       && haveSameTextures(*a.inputs, *b.inputs)
+                       && haveSameUniforms(*a.inputs, *b.inputs, *a.bindings);
+        };
+
+        auto& ring = output.uniformRing();
+        auto& batches = scratch.batches;
+        auto& blockOffsets = scratch.blockOffsets;
+        batches.clear();
+        blockOffsets.clear();
+        for (size_t first = 0; first < items.size();) {
+                auto const& head = items[first];
+
+                auto last = first + 1;
+                if (!head.bindings->instanceAttribs.empty()) {
+                        while (last < items.size() && isSameBatch(head, items[last])) {
+                                last++;
+                        }
+                }
+
+                batches.push_back({ first, last, blockOffsets.size() });
+                stageUniformBlocks(ring, *head.inputs, *head.bindings, blockOffsets);
+
+                first = last;
+        }
+        auto const blocksBase = ring.flush();
+
+        glstate::useProgram(program.programId);
+
+        auto& instances = scratch.instances;
+        for (auto const& batch : batches) {
+                auto const& head = items[batch.first];
+                auto const& vars = *head.bindings;
+
+                bindTextureInputs(output, *program.reflection, *head.inputs, vars);
+                bindFloatUniforms(*program.reflection, *head.inputs, vars);
+                bindIntUniforms(*program.reflection, *head.inputs, vars);
+                if (!vars.uniformBlocks.empty()) {
+                        bindUniformBlocks(ring, blocksBase, vars,
+                                          &blockOffsets[batch.firstBlock]);
+                }
+
+                instances.clear();
+                for (auto i = batch.first; i < batch.last; i++) {
+                        instances.push_back(items[i].inputs);
+                }
+                drawInstances(output, vars, head.mesh, &instances.front(), instances.size());
+        }
+}
+
+/**
+ * draw objects in runs of consecutive objects sharing their constant
+ * inputs, each with its variant of the program.
+ *
+ * @param program a ProgramHandle or an InternedProgramDef
+ */
+template <typename ProgramRef>
+static
+void innerDrawVariants(FrameSeries& output, ProgramRef const& program,
+                       FragmentOperationsDef const& fragmentOperations,
+                       RenderObjects objects)
+{
+        for (size_t first = 0; first < objects.size();) {
+                auto const& head = objects[first];
+                auto last = first + 1;
+                while (last < objects.size()
+                       && haveSameConstants(head.inputs, objects[last].inputs)) {
+                        last++;
+                }
+
+                innerDrawMany(output, output.program(program, head.inputs),
+                              fragmentOperations, RenderObjects { &head, last - first });
+                first = last;
+        }
+}
+
+static
+void innerDrawMany(FrameSeries& output, InternedProgramDef const& program,
+                   FragmentOperationsDef const& fragmentOperations,
+                   RenderObjects objects)
+{
+        if (!isDefined(program)) {
+                return;
+        }
+
+        innerDrawVariants(output, program, fragmentOperations, objects);
+}
+
+template <typename DrawFn>
+static
+void withOutputTo(FrameSeries::FramebufferMaterials const& fb,
+                  DrawFn draw)
+{
+        auto resolution = viewport();
+
+        glstate::bindFramebuffer(fb.framebufferId);
+        glDrawBuffer (GL_COLOR_ATTACHMENT0);
+        glReadBuffer (GL_COLOR_ATTACHMENT0);
+        glstate::setViewport (0, 0, fb.width, fb.height);
+
+        draw();
+
+        glstate::bindFramebuffer(0);
+        glReadBuffer (GL_BACK);
+        glDrawBuffer (GL_BACK);
+        glstate::setViewport(0, 0, resolution.first, resolution.second);
+}
+
+void setBudget(FrameSeries& output, FrameSeriesBudget const& budget)
+{
+        output.setBudget(budget);
+}
+
+void setProgramBinaryDirectory(FrameSeries& output, std::string const& directory)
+{
+        output.setProgramBinaryDirectory(directory);
+}
+
+FrameSeriesStats frameStats(FrameSeries const& output)
+{
+        return output.frameStats();
+}
+
+std::vector<FrameSeriesStats> frameStatsHistory(FrameSeries const& output)
+{
+        return output.frameStatsHistory();
+}
+
+FrameSeriesStats totalStats(FrameSeries const& output)
+{
+        return output.totalStats();
 }
 
 void beginFrame(FrameSeries& output)
@@ -341,48 +1017,370 @@ void beginFrame(FrameSeries& output)
 }
 
 void drawMany(FrameSeries& output,
-              FragmentOperationsDef fragmentOperations,
-              ProgramDef program,
-              std::vector<RenderObjectDef> objects)
+              FragmentOperationsDef const& fragmentOperations,
+              ProgramDef const& program,
+              RenderObjects objects)
+{
+        drawMany(output, fragmentOperations, intern(program), objects);
+}
+
+void drawMany(FrameSeries& output,
+              FragmentOperationsDef const& fragmentOperations,
+              InternedProgramDef const& program,
+              RenderObjects objects)
 {
-        FragmentOperationsScope withFO(fragmentOperations);
-        innerDrawMany(output, program, objects);
+        applyFragmentOperations(fragmentOperations);
+        innerDrawMany(output, program, fragmentOperations, objects);
 }
 
 TextureDef drawManyIntoTexture(FrameSeries& output,
-                               TextureDef spec,
-                               FragmentOperationsDef fragmentOperations,
-                               ProgramDef program,
-                               std::vector<RenderObjectDef> objects)
+                               TextureDef const& spec,
+                               FragmentOperationsDef const& fragmentOperations,
+                               ProgramDef const& program,
+                               RenderObjects objects)
 {
-        auto resolution = viewport();
-        auto fb = output.framebuffer(spec);
+        return drawManyIntoTexture(output, spec, fragmentOperations,
+                                   intern(program), objects);
+}
 
-        glBindFramebuffer(GL_FRAMEBUFFER, fb.framebufferId);
-        glDrawBuffer (GL_COLOR_ATTACHMENT0);
-        glReadBuffer (GL_COLOR_ATTACHMENT0);
-        glViewport (0, 0, fb.textureDef.width, fb.textureDef.height);
+TextureDef drawManyIntoTexture(FrameSeries& output,
+                               TextureDef const& spec,
+                               FragmentOperationsDef const& fragmentOperations,
+                               InternedProgramDef const& program,
+                               RenderObjects objects)
+{
+        // sampling a texture while drawing into it is undefined
+        auto const target = output.defineTarget(spec);
+        auto const feedback = output.samplesTarget(target, objects);
+        if (feedback) {
+                output.beginFeedback(target,
+                                     fragmentOperations.flags & FragmentOperationsDef::CLEAR);
+        }
 
-        {
-                FragmentOperationsScope withFO(fragmentOperations);
+        auto textureDef = TextureDef {};
+        withOutputTo(output.framebuffer(spec, textureDef), [&]() {
+                applyFragmentOperations(fragmentOperations);
+
+                innerDrawMany(output, program, fragmentOperations, objects);
+        });
 
-                innerDrawMany(output, program, objects);
+        if (feedback) {
+                output.endFeedback(target);
         }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glReadBuffer (GL_BACK);
-        glDrawBuffer (GL_BACK);
-        glViewport(0, 0, resolution.first, resolution.second);
+        return textureDef;
+}
+
+void drawOne(FrameSeries& output,
+             FragmentOperationsDef const& fragmentOperations,
+             ProgramDef const& programDef,
+             ProgramInputs const& inputs,
+             GeometryDef const& geometryDef)
+{
+        drawOne(output, fragmentOperations, intern(programDef), inputs,
+                geometryDef);
+}
+
+void drawOne(FrameSeries& output,
+             FragmentOperationsDef const& fragmentOperations,
+             InternedProgramDef const& programDef,
+             ProgramInputs const& inputs,
+             GeometryDef const& geometryDef)
+{
+        if (!isDefined(programDef)) {
+                return;
+        }
+
+        applyFragmentOperations(fragmentOperations);
+        innerDrawOne(output, output.program(programDef, inputs), inputs,
+                     output.mesh(geometryDef));
+}
+
+TextureHandle defineTexture(FrameSeries& output, TextureDef const& def)
+{
+        return output.defineTexture(def);
+}
+
+MeshHandle defineMesh(FrameSeries& output, GeometryDef const& def)
+{
+        return output.defineMesh(def);
+}
+
+ProgramHandle defineProgram(FrameSeries& output,
+                            InternedProgramDef const& def)
+{
+        if (!isDefined(def)) {
+                return {};
+        }
+        return output.defineProgram(def);
+}
+
+TargetHandle defineTarget(FrameSeries& output, TextureDef const& spec)
+{
+        return output.defineTarget(spec);
+}
+
+TextureHandle targetTexture(FrameSeries& output, TargetHandle target)
+{
+        return output.targetTexture(target);
+}
 
-        return fb.textureDef;
+TargetHandle scratchTarget(FrameSeries& output, ScratchTargetDef const& def)
+{
+        return output.scratchTarget(def);
+}
+
+void releaseScratchTarget(FrameSeries& output, TargetHandle target)
+{
+        output.releaseScratchTarget(target);
 }
 
 void drawOne(FrameSeries& output,
-             FragmentOperationsDef fragmentOperations,
-             ProgramDef programDef,
-             ProgramInputs inputs,
-             GeometryDef geometryDef)
+             FragmentOperationsDef const& fragmentOperations,
+             ProgramHandle program,
+             ProgramInputs const& inputs,
+             MeshHandle mesh)
 {
-        FragmentOperationsScope withFO(fragmentOperations);
-        innerDrawOne(output, programDef, inputs, geometryDef);
+        applyFragmentOperations(fragmentOperations);
+        innerDrawOne(output, output.program(program, inputs), inputs,
+                     output.mesh(mesh));
+}
+
+void drawMany(FrameSeries& output,
+              FragmentOperationsDef const& fragmentOperations,
+              ProgramHandle program,
+              RenderObjects objects)
+{
+        applyFragmentOperations(fragmentOperations);
+        innerDrawVariants(output, program, fragmentOperations, objects);
+}
+
+void drawManyInto(FrameSeries& output,
+                  TargetHandle target,
+                  FragmentOperationsDef const& fragmentOperations,
+                  ProgramHandle program,
+                  RenderObjects objects)
+{
+        if (!target.defined()) {
+                drawMany(output, fragmentOperations, program, objects);
+                return;
+        }
+
+        if (!output.framebuffer(target).framebufferId) {
+                printf("stale target, ignoring draws\n");
+                return;
+        }
+
+        // sampling a texture while drawing into it is undefined
+        auto const feedback = output.samplesTarget(target, objects);
+        if (feedback) {
+                output.beginFeedback(target,
+                                     fragmentOperations.flags & FragmentOperationsDef::CLEAR);
+        }
+
+        withOutputTo(output.framebuffer(target), [&]() {
+                applyFragmentOperations(fragmentOperations);
+
+                innerDrawVariants(output, program, fragmentOperations, objects);
+        });
+
+        if (feedback) {
+                output.endFeedback(target);
+        }
+}
+
+// recorded draws
+
+namespace
+{
+/// followed by objectCount ObjectRecord
+struct DrawCommand {
+        /// undefined for the current framebuffer
+        TargetHandle target;
+        ProgramHandle program;
+        FragmentOperationsDef fragmentOperations;
+        uint32_t objectCount;
+};
+
+/**
+ * followed by the texture handles, then the float values and the int
+ * values of its inputs, in the order and sizes of its schema
+ */
+struct ObjectRecord {
+        MeshHandle mesh;
+        uint32_t schema;
+};
+
+void appendBytes(std::vector<char>& bytes, void const* data, size_t size)
+{
+        auto const octets = static_cast<char const*> (data);
+        bytes.insert(std::end(bytes), octets, octets + size);
+}
+
+template <typename T>
+void appendPod(std::vector<char>& bytes, T const& value)
+{
+        appendBytes(bytes, &value, sizeof value);
+}
+
+template <typename T>
+char const* readPod(char const* cursor, T& value)
+{
+        std::memcpy(&value, cursor, sizeof value);
+        return cursor + sizeof value;
+}
+
+/// objects must refer to their mesh and textures by handle
+bool isRecordable(ProgramInputs const& inputs, MeshHandle mesh)
+{
+        return mesh.defined()
+               && std::all_of(std::begin(inputs.textures), std::end(inputs.textures),
+        [](ProgramInputs::TextureInput const& input) {
+                return input.texture.defined();
+        });
+}
+
+uint32_t recordedSchema(CommandBuffer& commands, ProgramInputs const& inputs)
+{
+        auto const hash = schemaHashOf(inputs);
+        for (size_t i = 0; i < commands.schemas.size(); i++) {
+                if (commands.schemaHashes[i] == hash
+                    && isSameSchema(commands.schemas[i], inputs)) {
+                        return i;
+                }
+        }
+        commands.schemas.push_back(schemaOf(inputs));
+        commands.schemaHashes.push_back(hash);
+        return commands.schemas.size() - 1;
+}
+
+void recordObject(CommandBuffer& commands,
+                  ProgramInputs const& inputs, MeshHandle mesh)
+{
+        appendPod(commands.bytes, ObjectRecord { mesh, recordedSchema(commands, inputs) });
+        for (auto const& input : inputs.textures) {
+                appendPod(commands.bytes, input.texture);
+        }
+        for (auto const& input : inputs.floatValues) {
+                appendBytes(commands.bytes, input.values.data(),
+                            input.values.size() * sizeof(float));
+        }
+        for (auto const& input : inputs.intValues) {
+                appendBytes(commands.bytes, input.values.data(),
+                            input.values.size() * sizeof(int32_t));
+        }
+}
+
+void recordDraw(CommandBuffer& commands,
+                TargetHandle target,
+                FragmentOperationsDef const& fragmentOperations,
+                ProgramHandle program,
+                RenderObjects objects)
+{
+        auto const recordable = [](RenderObjectDef const& object) {
+                return isRecordable(object.inputs, object.mesh);
+        };
+        auto const count = std::count_if(std::begin(objects), std::end(objects),
+                                         recordable);
+        if (size_t(count) != objects.size()) {
+                printf("only meshes and textures defined by handle can be recorded,"
+                       " skipping %lu objects\n", objects.size() - count);
+        }
+        if (count == 0) {
+                return;
+        }
+
+        appendPod(commands.bytes, DrawCommand {
+                target, program, fragmentOperations, uint32_t(count)
+        });
+        for (auto const& object : objects) {
+                if (recordable(object)) {
+                        recordObject(commands, object.inputs, object.mesh);
+                }
+        }
+}
+
+/// the values are read into a copy of the schema, sized accordingly
+char const* readObject(char const* cursor, CommandBuffer const& commands,
+                       RenderObjectDef& object)
+{
+        auto record = ObjectRecord {};
+        cursor = readPod(cursor, record);
+
+        object.mesh = record.mesh;
+        object.inputs = commands.schemas[record.schema];
+        for (auto& input : object.inputs.textures) {
+                cursor = readPod(cursor, input.texture);
+        }
+        for (auto& input : object.inputs.floatValues) {
+                auto const size = input.values.size() * sizeof(float);
+                std::memcpy(input.values.data(), cursor, size);
+                cursor += size;
+        }
+        for (auto& input : object.inputs.intValues) {
+                auto const size = input.values.size() * sizeof(int32_t);
+                std::memcpy(input.values.data(), cursor, size);
+                cursor += size;
+        }
+        return cursor;
+}
+}
+
+void drawOne(CommandBuffer& output,
+             FragmentOperationsDef const& fragmentOperations,
+             ProgramHandle program,
+             ProgramInputs const& inputs,
+             MeshHandle mesh)
+{
+        if (!isRecordable(inputs, mesh)) {
+                printf("only meshes and textures defined by handle can be recorded\n");
+                return;
+        }
+
+        appendPod(output.bytes, DrawCommand {
+                {}, program, fragmentOperations, 1
+        });
+        recordObject(output, inputs, mesh);
+}
+
+void drawMany(CommandBuffer& output,
+              FragmentOperationsDef const& fragmentOperations,
+              ProgramHandle program,
+              RenderObjects objects)
+{
+        recordDraw(output, {}, fragmentOperations, program, objects);
+}
+
+void drawManyInto(CommandBuffer& output,
+                  TargetHandle target,
+                  FragmentOperationsDef const& fragmentOperations,
+                  ProgramHandle program,
+                  RenderObjects objects)
+{
+        recordDraw(output, target, fragmentOperations, program, objects);
+}
+
+void execute(FrameSeries& output, CommandBuffer const& commands)
+{
+        auto& objects = output.drawScratch().recordedObjects;
+
+        auto cursor = commands.bytes.data();
+        auto const end = cursor + commands.bytes.size();
+        while (cursor < end) {
+                auto command = DrawCommand {};
+                cursor = readPod(cursor, command);
+
+                if (objects.size() < command.objectCount) {
+                        objects.resize(command.objectCount);
+                }
+                for (uint32_t i = 0; i < command.objectCount; i++) {
+                        cursor = readObject(cursor, commands, objects[i]);
+                }
+
+                auto const recorded = RenderObjects {
+                        objects.data(), command.objectCount
+                };
+                drawManyInto(output, command.target, command.fragmentOperations,
+                             command.program, recorded);
+        }
 }
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "../gl3companion/fnv1a.hpp"
+#include "../src/estd.hpp"
+
 #include <array>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -11,6 +15,32 @@
 class FrameSeries;
 class BufferResource;
 
+// handles
+
+/**
+ * generation checked reference to a resource held by a FrameSeries.
+ *
+ * a handle resolves by direct index, and stays valid for as long as
+ * its resource keeps being used from one frame to the next. Once the
+ * resource has been recycled, the handle is stale and resolves to
+ * nothing.
+ */
+template <typename Tag>
+struct ResourceHandle {
+        uint32_t slot = ~0u;
+        uint32_t generation = 0;
+
+        bool defined() const
+        {
+                return slot != ~0u;
+        }
+};
+
+using TextureHandle = ResourceHandle<struct TextureHandleTag>;
+using MeshHandle = ResourceHandle<struct MeshHandleTag>;
+using ProgramHandle = ResourceHandle<struct ProgramHandleTag>;
+using TargetHandle = ResourceHandle<struct TargetHandleTag>;
+
 // value types
 
 struct FragmentOperationsDef {
@@ -37,6 +67,19 @@ struct ProgramDef {
         FragmentShaderDef fragmentShader;
 };
 
+/**
+ * immutable, pre-hashed program definition.
+ *
+ * interning equal sources yields handles sharing the same definition,
+ * so that they compare in O(1) and are cheap to copy around.
+ */
+struct InternedProgramDef {
+        uint64_t hash;
+        std::shared_ptr<ProgramDef const> def;
+};
+
+InternedProgramDef intern(ProgramDef const& programDef);
+
 using TextureDefFn = void (*)(uint32_t*, int width, int height, int depth,
                               void const* data);
 
@@ -48,31 +91,172 @@ struct TextureDef {
         TextureDefFn pixelFiller;
 };
 
+/**
+ * inputs of a draw. their containers keep typical inputs inline, so
+ * that building them every frame does not allocate. names are short
+ * enough for the string's own inline storage.
+ */
 struct ProgramInputs {
         struct AttribArrayInput {
                 std::string name;
                 int componentCount;
+                /// inputNameHash(name), 0 when not known in advance
+                uint64_t nameHash = 0;
         };
         struct TextureInput {
                 std::string name;
                 TextureDef content;
+                /// when defined, used in place of content
+                TextureHandle texture;
+                uint64_t nameHash = 0;
         };
+        /**
+         * a uniform, or when the vertex shader declares it as an input
+         * instead, a per instance value: drawMany then draws objects
+         * differing only in such values with a single instanced draw.
+         *
+         * uniforms declared inside a std140 uniform block are packed
+         * into a buffer written once per draw call, rather than set one
+         * by one. this also applies to IntInput.
+         */
         struct FloatInput {
                 std::string name;
-                std::vector<float> values;
+                /// up to a 4x4 matrix
+                estd::small_vector<float, 16> values;
                 /// index of the last row
                 int last_row;
+                uint64_t nameHash = 0;
+                /// see constant()
+                bool constant = false;
         };
 
         struct IntInput {
                 std::string name;
-                std::vector<int32_t> values;
+                estd::small_vector<int32_t, 4> values;
+                uint64_t nameHash = 0;
+                bool constant = false;
         };
 
-        std::vector<AttribArrayInput> attribs;
-        std::vector<TextureInput> textures;
-        std::vector<FloatInput> floatValues;
-        std::vector<IntInput> intValues;
+        using FloatValues = decltype(FloatInput::values);
+
+        estd::small_vector<AttribArrayInput, 4> attribs;
+        estd::small_vector<TextureInput, 4> textures;
+        estd::small_vector<FloatInput, 8> floatValues;
+        estd::small_vector<IntInput, 4> intValues;
+};
+
+/**
+ * mark a value as constant across the draws using it.
+ *
+ * programs declaring it as a plain uniform are then specialized into
+ * a variant declaring it as a compile time constant, and it is no
+ * longer uploaded. variants are cached by their set of constant
+ * values, which are meant to change rarely if ever: each new set
+ * compiles a program. values derived from the viewport or the
+ * time are not constants.
+ */
+ProgramInputs::FloatInput constant(ProgramInputs::FloatInput input);
+ProgramInputs::IntInput constant(ProgramInputs::IntInput input);
+
+// typed inputs, declared once with their name and shape
+
+/// FNV-1a of an input name, computed at compile time for constants
+constexpr uint64_t inputNameHash(char const* name)
+{
+        return fnv1aString(name);
+}
+
+/**
+ * a float uniform of a fixed shape. Rows is 1 for scalars and
+ * vectors; matrix values are given row by row.
+ *
+ * e.g. `constexpr auto TRANSFORM = MatUniform<4> { "transform" };`
+ * then `TRANSFORM(matrix)` in the inputs of a draw.
+ */
+template <int Rows, int Columns>
+struct FloatUniform {
+        static_assert(Columns >= 1 && Columns <= 4, "1 to 4 columns");
+        static_assert(Rows == 1 || (Rows >= 2 && Rows <= 4 && Columns >= 2),
+                      "a vector, or a matrix of 2 to 4 rows and columns");
+
+        constexpr FloatUniform(char const* name) :
+                name(name), nameHash(inputNameHash(name))
+        {}
+
+        ProgramInputs::FloatInput operator()(float const (&values)[Rows * Columns]) const
+        {
+                return { name, { values, values + Rows * Columns }, Rows - 1, nameHash };
+        }
+
+        /**
+         * values of a length known at runtime. the length is checked
+         * against the uniform on the first draw of each program with
+         * it: a mismatching uniform is reported and left unset.
+         */
+        ProgramInputs::FloatInput operator()(ProgramInputs::FloatValues values) const
+        {
+                return { name, std::move(values), Rows - 1, nameHash };
+        }
+
+        char const* name;
+        uint64_t nameHash;
+};
+
+template <int N>
+using VecUniform = FloatUniform<1, N>;
+
+template <int Rows, int Columns = Rows>
+using MatUniform = FloatUniform<Rows, Columns>;
+
+template <int N>
+struct IntUniform {
+        static_assert(N >= 1 && N <= 4, "1 to 4 components");
+
+        constexpr IntUniform(char const* name) :
+                name(name), nameHash(inputNameHash(name))
+        {}
+
+        ProgramInputs::IntInput operator()(int32_t const (&values)[N]) const
+        {
+                return { name, { values, values + N }, nameHash };
+        }
+
+        char const* name;
+        uint64_t nameHash;
+};
+
+struct TextureUniform {
+        constexpr TextureUniform(char const* name) :
+                name(name), nameHash(inputNameHash(name))
+        {}
+
+        ProgramInputs::TextureInput operator()(TextureHandle texture) const
+        {
+                return { name, {}, texture, nameHash };
+        }
+
+        ProgramInputs::TextureInput operator()(TextureDef const& content) const
+        {
+                return { name, content, {}, nameHash };
+        }
+
+        char const* name;
+        uint64_t nameHash;
+};
+
+template <int ComponentCount>
+struct VertexAttrib {
+        constexpr VertexAttrib(char const* name) :
+                name(name), nameHash(inputNameHash(name))
+        {}
+
+        ProgramInputs::AttribArrayInput operator()() const
+        {
+                return { name, ComponentCount, nameHash };
+        }
+
+        char const* name;
+        uint64_t nameHash;
 };
 
 struct GeometryDef {
@@ -80,6 +264,9 @@ struct GeometryDef {
         size_t arrayCount = 0;
 
         // @returns indices count
+        //
+        // the buffers are scratch space: their content is copied into
+        // storage shared by all meshes once the definer returns.
         size_t (*definer)(BufferResource const& elementBuffer,
                           BufferResource const arrays[],
                           void const* data) = nullptr;
@@ -88,27 +275,220 @@ struct GeometryDef {
 struct RenderObjectDef {
         ProgramInputs inputs;
         GeometryDef geometry;
+        /// when defined, used in place of geometry
+        MeshHandle mesh;
 };
 
 using FrameSeriesResource =
         std::unique_ptr<FrameSeries, std::function<void(FrameSeries*)>>;
 FrameSeriesResource makeFrameSeries();
 
+/**
+ * limits on the gpu memory held by a frame series.
+ *
+ * resources left unused by the last frame are released, least
+ * recently used first, until each kind fits in its budget.
+ */
+struct FrameSeriesBudget {
+        /// storage of textures, excluding framebuffer attachments
+        size_t textureBytes = size_t(128) << 20;
+        /// color and depth storage of framebuffers
+        size_t framebufferBytes = size_t(128) << 20;
+        /// vertex and index buffers storage
+        size_t bufferBytes = size_t(32) << 20;
+        /// resources unused for that many frames are always released
+        int idleFrameCount = 300;
+};
+
+void setBudget(FrameSeries& output, FrameSeriesBudget const& budget);
+
+/**
+ * keep linked programs in directory, for later runs to load instead of
+ * compiling them. entries are keyed by the program sources and the
+ * driver, and recompiled when either changes.
+ */
+void setProgramBinaryDirectory(FrameSeries& output, std::string const& directory);
+
+/**
+ * cache behaviour and memory use of a frame series, over one frame
+ * or since its creation.
+ */
+struct FrameSeriesStats {
+        struct Kind {
+                /// lookups served by an existing resource
+                long hits = 0;
+                /// lookups of unknown definitions or stale handles
+                long misses = 0;
+                /// resources allocated
+                long creations = 0;
+                /// resources redefined in place of an unused one
+                long recycles = 0;
+                /// resources released by the budget
+                long evictions = 0;
+                /// resources alive at the end of the frame
+                size_t liveCount = 0;
+                /// estimated gpu storage at the end of the frame
+                size_t bytes = 0;
+        };
+
+        /// frame number, starting at 1
+        uint64_t frame = 0;
+        /// GL state changes requested by the frame
+        long stateCalls = 0;
+        /// of which matched the current state and were skipped
+        long redundantStateCalls = 0;
+        /// textures by size, as RGBA8. framebuffer attachments excluded
+        Kind textures;
+        /// color attachments and depth renderbuffers
+        Kind framebuffers;
+        /// vertex and index buffers
+        Kind meshes;
+        Kind programs;
+};
+
+/// number of frames kept by frameStatsHistory
+size_t const FRAME_STATS_HISTORY_SIZE = 240;
+
+/// statistics of the last completed frame
+FrameSeriesStats frameStats(FrameSeries const& output);
+
+/// statistics of the last completed frames, oldest first
+std::vector<FrameSeriesStats> frameStatsHistory(FrameSeries const& output);
+
+/// counters cumulated since creation, gauges of the last completed frame
+FrameSeriesStats totalStats(FrameSeries const& output);
+
 void beginFrame(FrameSeries& output);
 
 void drawOne(FrameSeries& output,
-             FragmentOperationsDef fragmentOperationsDef,
-             ProgramDef programDef,
-             ProgramInputs inputs,
-             GeometryDef geometryDef);
+             FragmentOperationsDef const& fragmentOperationsDef,
+             ProgramDef const& programDef,
+             ProgramInputs const& inputs,
+             GeometryDef const& geometryDef);
 
+void drawOne(FrameSeries& output,
+             FragmentOperationsDef const& fragmentOperationsDef,
+             InternedProgramDef const& programDef,
+             ProgramInputs const& inputs,
+             GeometryDef const& geometryDef);
+
+/// objects to draw, e.g. a std::vector or an array
+using RenderObjects = estd::span<RenderObjectDef const>;
+
+/**
+ * objects may be drawn out of order when depth tested without
+ * blending, to group objects sharing textures and meshes.
+ */
 void drawMany(FrameSeries& output,
-              FragmentOperationsDef fragmentOperationsDef,
-              ProgramDef program,
-              std::vector<RenderObjectDef> objects);
+              FragmentOperationsDef const& fragmentOperationsDef,
+              ProgramDef const& program,
+              RenderObjects objects);
 
+void drawMany(FrameSeries& output,
+              FragmentOperationsDef const& fragmentOperationsDef,
+              InternedProgramDef const& program,
+              RenderObjects objects);
+
+/**
+ * @returns the texture drawn into. passed back as spec, later draws
+ * go into the same target, keeping its content.
+ */
 TextureDef drawManyIntoTexture(FrameSeries& output,
-                               TextureDef spec,
-                               FragmentOperationsDef fragmentOperationsDef,
-                               ProgramDef program,
-                               std::vector<RenderObjectDef> objects);
+                               TextureDef const& spec,
+                               FragmentOperationsDef const& fragmentOperationsDef,
+                               ProgramDef const& program,
+                               RenderObjects objects);
+
+TextureDef drawManyIntoTexture(FrameSeries& output,
+                               TextureDef const& spec,
+                               FragmentOperationsDef const& fragmentOperationsDef,
+                               InternedProgramDef const& program,
+                               RenderObjects objects);
+
+// retained mode, where resources are defined once then referred to by handle
+
+TextureHandle defineTexture(FrameSeries& output, TextureDef const& def);
+MeshHandle defineMesh(FrameSeries& output, GeometryDef const& def);
+ProgramHandle defineProgram(FrameSeries& output,
+                            InternedProgramDef const& def);
+TargetHandle defineTarget(FrameSeries& output, TextureDef const& spec);
+
+/// texture the target renders into
+TextureHandle targetTexture(FrameSeries& output, TargetHandle target);
+
+struct ScratchTargetDef {
+        enum Format {
+                RGBA16F,
+                RGBA8,
+        };
+
+        int width;
+        int height;
+        Format format = RGBA16F;
+        bool depth = true;
+};
+
+/**
+ * a target for the current frame, taken from a pool of free targets
+ * of the same size, format and depth. it returns to the pool when
+ * released, or at the latest when the next frame begins. targets left
+ * in the pool are released by the budget like any other.
+ */
+TargetHandle scratchTarget(FrameSeries& output, ScratchTargetDef const& def);
+void releaseScratchTarget(FrameSeries& output, TargetHandle target);
+
+void drawOne(FrameSeries& output,
+             FragmentOperationsDef const& fragmentOperationsDef,
+             ProgramHandle program,
+             ProgramInputs const& inputs,
+             MeshHandle mesh);
+
+void drawMany(FrameSeries& output,
+              FragmentOperationsDef const& fragmentOperationsDef,
+              ProgramHandle program,
+              RenderObjects objects);
+
+/// the undefined target stands for the current framebuffer
+void drawManyInto(FrameSeries& output,
+                  TargetHandle target,
+                  FragmentOperationsDef const& fragmentOperationsDef,
+                  ProgramHandle program,
+                  RenderObjects objects);
+
+// recorded draws
+
+/**
+ * retained mode draws recorded as plain data, to be executed later
+ * and as many times as needed.
+ *
+ * recording resolves nothing against GL, so it may happen away from
+ * the GL thread. handles are only resolved on execution, where stale
+ * ones are skipped.
+ */
+struct CommandBuffer {
+        /// packed draw commands, each followed by its objects and values
+        std::vector<char> bytes;
+        /// names and shapes of the recorded inputs, referred to by index
+        std::vector<ProgramInputs> schemas;
+        std::vector<uint64_t> schemaHashes;
+};
+
+void drawOne(CommandBuffer& output,
+             FragmentOperationsDef const& fragmentOperationsDef,
+             ProgramHandle program,
+             ProgramInputs const& inputs,
+             MeshHandle mesh);
+
+void drawMany(CommandBuffer& output,
+              FragmentOperationsDef const& fragmentOperationsDef,
+              ProgramHandle program,
+              RenderObjects objects);
+
+void drawManyInto(CommandBuffer& output,
+                  TargetHandle target,
+                  FragmentOperationsDef const& fragmentOperationsDef,
+                  ProgramHandle program,
+                  RenderObjects objects);
+
+/// replay recorded draws, in order
+void execute(FrameSeries& output, CommandBuffer const& commands);
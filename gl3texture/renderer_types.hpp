@@ -2,18 +2,67 @@
 
 #include "renderer.hpp"
 
+#include "../gl3companion/fnv1a.hpp"
 #include "../gl3companion/gldebug.hpp"
 #include "../gl3companion/glframebuffers.hpp"
+#include "../gl3companion/glprogrambinaries.hpp"
 #include "../gl3companion/glresource_types.hpp"
 #include "../gl3companion/glshaders.hpp"
+#include "../gl3companion/glstate.hpp"
+#include "../gl3companion/glstream.hpp"
 #include "../gl3companion/gltexturing.hpp"
+#include "../src/estd.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 using FramebufferDef = TextureDef;
 
 namespace
 {
+template <typename T>
+uint64_t hashValue(T const& value, uint64_t hash)
+{
+        return fnv1a(&value, sizeof value, hash);
+}
+
+uint64_t hashOf(TextureDef const& def)
+{
+        auto hash = fnv1a(def.data.data(), def.data.size());
+        hash = hashValue(def.width, hash);
+        hash = hashValue(def.height, hash);
+        hash = hashValue(def.depth, hash);
+        return hashValue(def.pixelFiller, hash);
+}
+
+uint64_t hashOf(GeometryDef const& def)
+{
+        auto hash = fnv1a(def.data.data(), def.data.size());
+        hash = hashValue(def.arrayCount, hash);
+        return hashValue(def.definer, hash);
+}
+
+uint64_t hashOf(ProgramDef const& def)
+{
+        auto const& vs = def.vertexShader.source;
+        auto const& fs = def.fragmentShader.source;
+        auto hash = fnv1a(vs.data(), vs.size());
+        hash = hashValue(vs.size(), hash);
+        return fnv1a(fs.data(), fs.size(), hash);
+}
+
+uint64_t hashOf(InternedProgramDef const& def)
+{
+        return def.hash;
+}
+
 bool isEqual(TextureDef const& a, TextureDef const& b)
 {
         return a.data == b.data
@@ -23,167 +72,1333 @@ bool isEqual(TextureDef const& a, TextureDef const& b)
                && a.pixelFiller == b.pixelFiller;
 }
 
-void framebufferPixelFiller(uint32_t* pixels, int width, int height,
-                            int depth, void const* data)
-{
-        printf("data: %p\n", data);
-        // this function is just an identifier
-        printf("ERROR: I should not be called, framebuffer: %d\n", *((GLint*)data));
-}
-}
+bool isEqual(GeometryDef const& a, GeometryDef const& b)
+{
+        return a.data == b.data
+               && a.definer == b.definer
+               && a.arrayCount == b.arrayCount;
+}
+
+bool isEqual(ProgramDef const& a, ProgramDef const& b)
+{
+        return a.fragmentShader.source == b.fragmentShader.source
+               && a.vertexShader.source == b.vertexShader.source;
+}
+
+bool isEqual(InternedProgramDef const& a, InternedProgramDef const& b)
+{
+        // interning guarantees equal sources share their definition
+        return a.def == b.def;
+}
+
+/// as computed by inputNameHash, unless declared with it
+template <typename Input>
+uint64_t nameHashOf(Input const& input)
+{
+        return input.nameHash ? input.nameHash
+               : fnv1a(input.name.data(), input.name.size());
+}
+
+/// hash of the names and shapes of inputs, ignoring their values
+uint64_t schemaHashOf(ProgramInputs const& inputs)
+{
+        auto hash = hashValue(inputs.textures.size(), FNV1A_BASIS);
+        for (auto const& input : inputs.textures) {
+                hash = hashValue(nameHashOf(input), hash);
+        }
+        hash = hashValue(inputs.attribs.size(), hash);
+        for (auto const& input : inputs.attribs) {
+                hash = hashValue(nameHashOf(input), hash);
+                hash = hashValue(input.componentCount, hash);
+        }
+        hash = hashValue(inputs.floatValues.size(), hash);
+        for (auto const& input : inputs.floatValues) {
+                hash = hashValue(nameHashOf(input), hash);
+                hash = hashValue(input.values.size(), hash);
+                hash = hashValue(input.last_row, hash);
+                hash = hashValue(input.constant, hash);
+        }
+        hash = hashValue(inputs.intValues.size(), hash);
+        for (auto const& input : inputs.intValues) {
+                hash = hashValue(nameHashOf(input), hash);
+                hash = hashValue(input.values.size(), hash);
+                hash = hashValue(input.constant, hash);
+        }
+        return hash;
+}
+
+template <typename Input>
+bool isSameName(Input const& x, Input const& y)
+{
+        if (x.nameHash && y.nameHash) {
+                return x.nameHash == y.nameHash;
+        }
+        return x.name == y.name;
+}
+
+template <typename Inputs, typename SameShape>
+bool haveSameNames(Inputs const& a, Inputs const& b, SameShape sameShape)
+{
+        using Input = typename Inputs::value_type;
+        return a.size() == b.size()
+               && std::equal(std::begin(a), std::end(a), std::begin(b),
+        [&sameShape](Input const& x, Input const& y) {
+                return isSameName(x, y) && sameShape(x, y);
+        });
+}
+
+bool isSameSchema(ProgramInputs const& a, ProgramInputs const& b)
+{
+        using Inputs = ProgramInputs;
+        return haveSameNames(a.textures, b.textures,
+        [](Inputs::TextureInput const&, Inputs::TextureInput const&) {
+                return true;
+        })
+        && haveSameNames(a.attribs, b.attribs,
+        [](Inputs::AttribArrayInput const& x, Inputs::AttribArrayInput const& y) {
+                return x.componentCount == y.componentCount;
+        })
+        && haveSameNames(a.floatValues, b.floatValues,
+        [](Inputs::FloatInput const& x, Inputs::FloatInput const& y) {
+                return x.values.size() == y.values.size() && x.last_row == y.last_row
+                       && x.constant == y.constant;
+        })
+        && haveSameNames(a.intValues, b.intValues,
+        [](Inputs::IntInput const& x, Inputs::IntInput const& y) {
+                return x.values.size() == y.values.size() && x.constant == y.constant;
+        });
+}
+
+/// the inputs stripped of their texture contents. values are kept
+/// for their shape
+ProgramInputs schemaOf(ProgramInputs const& inputs)
+{
+        auto schema = ProgramInputs {};
+        schema.attribs = inputs.attribs;
+        for (auto const& input : inputs.textures) {
+                schema.textures.push_back({ input.name, {}, {}, input.nameHash });
+        }
+        schema.floatValues = inputs.floatValues;
+        schema.intValues = inputs.intValues;
+        return schema;
+}
+
+bool hasConstants(ProgramInputs const& inputs)
+{
+        auto const isConstant = [](auto const& input) {
+                return input.constant;
+        };
+        return std::any_of(std::begin(inputs.floatValues), std::end(inputs.floatValues),
+                           isConstant)
+               || std::any_of(std::begin(inputs.intValues), std::end(inputs.intValues),
+                              isConstant);
+}
+
+/// hash of the names and values of the inputs marked constant
+uint64_t constantsHashOf(ProgramInputs const& inputs, uint64_t hash)
+{
+        for (auto const& input : inputs.floatValues) {
+                if (input.constant) {
+                        hash = hashValue(nameHashOf(input), hash);
+                        hash = hashValue(input.last_row, hash);
+                        hash = fnv1a(input.values.data(),
+                                     input.values.size() * sizeof(float), hash);
+                }
+        }
+        for (auto const& input : inputs.intValues) {
+                if (input.constant) {
+                        hash = hashValue(nameHashOf(input), hash);
+                        hash = fnv1a(input.values.data(),
+                                     input.values.size() * sizeof(int32_t), hash);
+                }
+        }
+        return hash;
+}
+
+bool isSameConstant(ProgramInputs::FloatInput const& x, ProgramInputs::FloatInput const& y)
+{
+        return isSameName(x, y) && x.last_row == y.last_row && x.values == y.values;
+}
+
+bool isSameConstant(ProgramInputs::IntInput const& x, ProgramInputs::IntInput const& y)
+{
+        return isSameName(x, y) && x.values == y.values;
+}
+
+/// pairs the inputs marked constant, in order, ignoring the others
+template <typename Inputs>
+bool haveSameConstantInputs(Inputs const& a, Inputs const& b)
+{
+        auto x = std::begin(a);
+        auto y = std::begin(b);
+        auto const skipValues = [](decltype(x) input, decltype(x) end) {
+                while (input != end && !input->constant) {
+                        ++input;
+                }
+                return input;
+        };
+        for (;;) {
+                x = skipValues(x, std::end(a));
+                y = skipValues(y, std::end(b));
+                if (x == std::end(a) || y == std::end(b)) {
+                        return x == std::end(a) && y == std::end(b);
+                }
+                if (!isSameConstant(*x, *y)) {
+                        return false;
+                }
+                ++x;
+                ++y;
+        }
+}
+
+/// the same program variant serves both inputs
+bool haveSameConstants(ProgramInputs const& a, ProgramInputs const& b)
+{
+        return haveSameConstantInputs(a.floatValues, b.floatValues)
+               && haveSameConstantInputs(a.intValues, b.intValues);
+}
+
+/// the inputs marked constant
+ProgramInputs constantsOf(ProgramInputs const& inputs)
+{
+        auto constants = ProgramInputs {};
+        for (auto const& input : inputs.floatValues) {
+                if (input.constant) {
+                        constants.floatValues.push_back(input);
+                }
+        }
+        for (auto const& input : inputs.intValues) {
+                if (input.constant) {
+                        constants.intValues.push_back(input);
+                }
+        }
+        return constants;
+}
+
+bool isDeclarableAs(ProgramInputs::FloatInput const& input, std::string const& type)
+{
+        auto const rows = 1 + input.last_row;
+        auto const columns = int(input.values.size()) / rows;
+        auto const isFinite = [](float value) {
+                return std::isfinite(value);
+        };
+        if (rows * columns != int(input.values.size())
+            || !std::all_of(std::begin(input.values), std::end(input.values), isFinite)) {
+                return false;
+        }
+        if (rows == 1) {
+                return type == (columns == 1 ? "float" : "vec" + std::to_string(columns));
+        }
+        return type == "mat" + std::to_string(columns) + "x" + std::to_string(rows)
+               || (rows == columns && type == "mat" + std::to_string(columns));
+}
+
+bool isDeclarableAs(ProgramInputs::IntInput const& input, std::string const& type)
+{
+        auto const width = input.values.size();
+        return type == (width == 1 ? "int" : "ivec" + std::to_string(width));
+}
+
+/// GLSL constructor arguments, column by column for matrices
+std::string constructorArguments(ProgramInputs::FloatInput const& input)
+{
+        auto const rows = size_t(1 + input.last_row);
+        auto const columns = input.values.size() / rows;
+        auto arguments = std::string {};
+        for (size_t column = 0; column < columns; column++) {
+                for (size_t row = 0; row < rows; row++) {
+                        // enough digits to read back the same float
+                        char literal[32];
+                        snprintf(literal, sizeof literal, "%.9g",
+                                 input.values[row * columns + column]);
+                        arguments += arguments.empty() ? "" : ", ";
+                        arguments += literal;
+                }
+        }
+        return arguments;
+}
+
+std::string constructorArguments(ProgramInputs::IntInput const& input)
+{
+        auto arguments = std::string {};
+        for (auto value : input.values) {
+                arguments += arguments.empty() ? "" : ", ";
+                arguments += std::to_string(value);
+        }
+        return arguments;
+}
+
+/**
+ * rewrite the `uniform <type> <name>;` declaration of an input into a
+ * constant one, when its type matches the shape of the input. inputs
+ * declared otherwise, e.g. inside uniform blocks, stay uniforms.
+ */
+template <typename Input>
+void declareConstant(std::string& source, Input const& input)
+{
+        auto const isIdentifier = [](char c) {
+                return std::isalnum(static_cast<unsigned char> (c)) || c == '_';
+        };
+        auto const keyword = std::string { "uniform" };
+
+        for (auto start = source.find(keyword); start != std::string::npos;
+             start = source.find(keyword, start + keyword.size())) {
+                auto cursor = start + keyword.size();
+                auto const skipSpaces = [&source, &cursor]() {
+                        auto const first = cursor;
+                        while (cursor < source.size()
+                               && std::isspace(static_cast<unsigned char> (source[cursor]))) {
+                                cursor++;
+                        }
+                        return cursor != first;
+                };
+                auto const identifier = [&source, &cursor, &isIdentifier]() {
+                        auto const first = cursor;
+                        while (cursor < source.size() && isIdentifier(source[cursor])) {
+                                cursor++;
+                        }
+                        return source.substr(first, cursor - first);
+                };
+
+                if (start > 0 && isIdentifier(source[start - 1])) {
+                        continue;
+                }
+                if (!skipSpaces()) {
+                        continue;
+                }
+                auto const type = identifier();
+                skipSpaces();
+                auto const name = identifier();
+                skipSpaces();
+                if (name != input.name || cursor >= source.size() || source[cursor] != ';') {
+                        continue;
+                }
+
+                if (isDeclarableAs(input, type)) {
+                        source.replace(start, cursor - start,
+                                       "const " + type + " " + name + " = "
+                                       + type + "(" + constructorArguments(input) + ")");
+                }
+                return;
+        }
+}
+
+/// the program with its constant inputs declared as such
+ProgramDef specializedDef(ProgramDef const& def, ProgramInputs const& inputs)
+{
+        auto specialized = def;
+        auto const declare = [&specialized](auto const& input) {
+                if (input.constant) {
+                        declareConstant(specialized.vertexShader.source, input);
+                        declareConstant(specialized.fragmentShader.source, input);
+                }
+        };
+        std::for_each(std::begin(inputs.floatValues), std::end(inputs.floatValues), declare);
+        std::for_each(std::begin(inputs.intValues), std::end(inputs.intValues), declare);
+        return specialized;
+}
+
+void framebufferPixelFiller(uint32_t* pixels, int width, int height,
+                            int depth, void const* data)
+{
+        printf("data: %p\n", data);
+        // this function is just an identifier
+        printf("ERROR: I should not be called, framebuffer: %d\n", *((GLint*)data));
+}
+}
+
+/// locations of program inputs, in the order of ProgramInputs
+struct ProgramBindings {
+        std::vector<GLint> textureUniforms;
+        /// into the int shadows of the program, see ProgramReflection
+        std::vector<size_t> textureShadows;
+
+        struct ArrayAttrib {
+                GLint id;
+                int componentCount;
+        };
+        std::vector<ArrayAttrib> arrayAttribs;
+
+        /// plain uniforms, with the upload call chosen for their shape
+        using FloatUploadFn = void (*)(GLint id, GLfloat const* values);
+        struct FloatUpload {
+                GLint id;
+                size_t inputIndex;
+                FloatUploadFn upload;
+                /// into the float shadows of the program
+                size_t shadow;
+        };
+        std::vector<FloatUpload> floatUploads;
+
+        using IntUploadFn = void (*)(GLint id, GLint const* values);
+        struct IntUpload {
+                GLint id;
+                size_t inputIndex;
+                IntUploadFn upload;
+                size_t shadow;
+        };
+        std::vector<IntUpload> intUploads;
+
+        /// float inputs declared as vertex shader inputs, one value per instance
+        struct InstanceAttrib {
+                GLint id;
+                int rows;
+                int columns;
+                size_t floatInputIndex;
+                /// in floats, within the instance record
+                size_t offset;
+        };
+        std::vector<InstanceAttrib> instanceAttribs;
+        /// in floats
+        size_t instanceStride = 0;
+
+        /// uniform blocks holding inputs, bound to their block index
+        struct UniformBlockBinding {
+                GLuint binding;
+                size_t dataSize;
+        };
+        std::vector<UniformBlockBinding> uniformBlocks;
+
+        /// inputs declared inside uniform blocks, written into the ring
+        struct BlockField {
+                /// into uniformBlocks
+                size_t blockSlot;
+                bool isInt;
+                size_t inputIndex;
+                UniformBlockMember member;
+        };
+        std::vector<BlockField> blockFields;
+};
+
+/**
+ * variables of a linked program, introspected once, and the
+ * bindings of every input schema it was drawn with.
+ */
+struct ProgramReflection {
+        ShaderVariables uniforms;
+        ShaderVariables attributes;
+        UniformBlocks uniformBlocks;
+
+        /**
+         * values last uploaded to a plain uniform, shared by the schemas
+         * binding it, for unchanged values not to be uploaded again.
+         */
+        struct UniformShadow {
+                GLint id;
+                /// into the shadow values
+                size_t offset;
+                size_t count;
+                bool uploaded;
+        };
+        std::vector<UniformShadow> floatShadows;
+        std::vector<float> floatShadowValues;
+        std::vector<UniformShadow> intShadows;
+        std::vector<int32_t> intShadowValues;
+
+        struct SchemaBindings {
+                ProgramInputs schema;
+                ProgramBindings bindings;
+        };
+        /// by schema hash
+        std::unordered_multimap<uint64_t, SchemaBindings> schemas;
+};
+
+/// vertex arrays of a mesh, one per attribute layout it was drawn with
+struct VertexArrayCache {
+        struct Layout {
+                std::vector<ProgramBindings::ArrayAttrib> attribs;
+                std::vector<ProgramBindings::InstanceAttrib> instanceAttribs;
+                VertexArrayResource vertexArray;
+        };
+        std::vector<Layout> layouts;
+        /// of the arena storage the layouts refer to
+        uint64_t storageGeneration = 0;
+};
+
+/**
+ * index and vertex storage shared by all meshes.
+ *
+ * each lane is a single buffer, suballocated first fit from a free
+ * list. a lane grows by copying into a larger buffer, which changes
+ * the storage generation.
+ */
+class GeometryArena
+{
+public:
+        enum Lane {
+                INDICES,
+                VERTICES,
+                LANE_COUNT,
+        };
+
+        /// space in a lane, returned to the arena when destroyed
+        class Range
+        {
+        public:
+                Range() = default;
+                Range(GeometryArena* arena, Lane lane, size_t offset, size_t size) :
+                        arena(arena), lane(lane), offset(offset), size(size)
+                {}
+                Range(Range&& other)
+                {
+                        *this = std::move(other);
+                }
+                Range& operator=(Range&& other)
+                {
+                        if (this != &other) {
+                                release();
+                                arena = other.arena;
+                                lane = other.lane;
+                                offset = other.offset;
+                                size = other.size;
+                                other.arena = nullptr;
+                        }
+                        return *this;
+                }
+                ~Range()
+                {
+                        release();
+                }
+
+                GeometryArena* arena = nullptr;
+                Lane lane = INDICES;
+                size_t offset = 0;
+                size_t size = 0;
+
+        private:
+                Range(Range const&) = delete;
+                Range& operator=(Range const&) = delete;
+
+                void release()
+                {
+                        if (arena) {
+                                arena->release(lane, offset, size);
+                                arena = nullptr;
+                        }
+                }
+        };
+
+        /// copy the content of a buffer into the lane
+        Range store(Lane lane, BufferResource const& source, size_t size)
+        {
+                auto& storage = lanes[lane];
+                auto const alignedSize = alignUp(size);
+
+                auto block = findFreeBlock(storage, alignedSize);
+                if (block == std::end(storage.freeBlocks)) {
+                        grow(storage, alignedSize);
+                        block = findFreeBlock(storage, alignedSize);
+                }
+
+                auto const offset = block->offset;
+                block->offset += alignedSize;
+                block->size -= alignedSize;
+                if (block->size == 0) {
+                        storage.freeBlocks.erase(block);
+                }
+
+                if (size > 0) {
+                        glstate::bindBuffer(GL_COPY_READ_BUFFER, source.id);
+                        glstate::bindBuffer(GL_COPY_WRITE_BUFFER, storage.buffer.id);
+                        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                            0, offset, size);
+                        OGL_TRACE;
+                }
+
+                return { this, lane, offset, alignedSize };
+        }
+
+        GLuint buffer(Lane lane) const
+        {
+                return lanes[lane].buffer.id;
+        }
+
+        uint64_t storageGeneration() const
+        {
+                return generation;
+        }
+
+private:
+        struct Block {
+                size_t offset;
+                size_t size;
+        };
+
+        struct Storage {
+                BufferResource buffer;
+                size_t capacity = 0;
+                /// by offset
+                std::vector<Block> freeBlocks;
+        };
+
+        static size_t alignUp(size_t size)
+        {
+                return (size + 15) / 16 * 16;
+        }
+
+        static std::vector<Block>::iterator findFreeBlock(Storage& storage, size_t size)
+        {
+                return std::find_if(std::begin(storage.freeBlocks),
+                                    std::end(storage.freeBlocks),
+                [size](Block const& block) {
+                        return block.size >= size;
+                });
+        }
+
+        void grow(Storage& storage, size_t size)
+        {
+                auto const oldCapacity = storage.capacity;
+                auto const newCapacity = std::max(std::max(2 * oldCapacity,
+                                                  oldCapacity + size),
+                                                  size_t(1) << 20);
+
+                auto larger = BufferResource {};
+                glstate::bindBuffer(GL_COPY_WRITE_BUFFER, larger.id);
+                glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, GL_STATIC_DRAW);
+                if (oldCapacity > 0) {
+                        glstate::bindBuffer(GL_COPY_READ_BUFFER, storage.buffer.id);
+                        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                            0, 0, oldCapacity);
+                }
+                // the previous buffer gets deleted with `larger`
+                std::swap(storage.buffer.id, larger.id);
+
+                storage.capacity = newCapacity;
+                addFreeBlock(storage, { oldCapacity, newCapacity - oldCapacity });
+                generation++;
+                OGL_TRACE;
+        }
+
+        void release(Lane lane, size_t offset, size_t size)
+        {
+                if (size > 0) {
+                        addFreeBlock(lanes[lane], { offset, size });
+                }
+        }
+
+        static void addFreeBlock(Storage& storage, Block block)
+        {
+                auto& blocks = storage.freeBlocks;
+                auto next = std::find_if(std::begin(blocks), std::end(blocks),
+                [&block](Block const& other) {
+                        return other.offset > block.offset;
+                });
+                next = blocks.insert(next, block);
+
+                // coalesce with the neighbours
+                auto following = next + 1;
+                if (following != std::end(blocks)
+                    && next->offset + next->size == following->offset) {
+                        next->size += following->size;
+                        blocks.erase(following);
+                }
+                if (next != std::begin(blocks)) {
+                        auto preceding = next - 1;
+                        if (preceding->offset + preceding->size == next->offset) {
+                                preceding->size += next->size;
+                                blocks.erase(next);
+                        }
+                }
+        }
+
+        Storage lanes[LANE_COUNT];
+        uint64_t generation = 1;
+};
+
+/**
+ * stream of std140 uniform block data.
+ *
+ * blocks are staged on the CPU then written into the buffer in one
+ * go. the buffer is written linearly and respecified when full, so
+ * that ranges still in use by the GPU are never overwritten.
+ */
+class UniformBufferRing
+{
+public:
+        /// @returns the offset of zeroed space for a block, in the staging area
+        size_t stage(size_t size)
+        {
+                if (alignment == 0) {
+                        GLint value = 0;
+                        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+                        alignment = std::max(GLint(1), value);
+                }
+
+                auto const offset = alignUp(staging.size());
+                staging.resize(offset + size, 0);
+                return offset;
+        }
+
+        char* staged(size_t offset)
+        {
+                return &staging[offset];
+        }
+
+        /// @returns the buffer offset where the staging area now starts
+        size_t flush()
+        {
+                auto const size = staging.size();
+                if (size == 0) {
+                        return 0;
+                }
+
+                glstate::bindBuffer(GL_UNIFORM_BUFFER, buffer.id);
+                if (size > capacity) {
+                        auto const minCapacity = size_t(64 << 10);
+                        capacity = std::max(std::max(size, 2*capacity), minCapacity);
+                        glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+                        head = 0;
+                } else if (head + size > capacity) {
+                        // orphan the storage still read by the GPU
+                        glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+                        head = 0;
+                }
+
+                auto const destination =
+                        glMapBufferRange(GL_UNIFORM_BUFFER, head, size,
+                                         GL_MAP_WRITE_BIT
+                                         | GL_MAP_INVALIDATE_RANGE_BIT
+                                         | GL_MAP_UNSYNCHRONIZED_BIT);
+                if (destination) {
+                        std::copy(std::begin(staging), std::end(staging),
+                                  static_cast<char*> (destination));
+                        glUnmapBuffer(GL_UNIFORM_BUFFER);
+                }
+                OGL_TRACE;
+
+                auto const base = head;
+                head = alignUp(head + size);
+                staging.clear();
+                return base;
+        }
+
+        GLuint id() const
+        {
+                return buffer.id;
+        }
+
+private:
+        size_t alignUp(size_t offset) const
+        {
+                return (offset + alignment - 1) / alignment * alignment;
+        }
+
+        BufferResource buffer;
+        size_t capacity = 0;
+        size_t head = 0;
+        size_t alignment = 0;
+        std::vector<char> staging;
+};
+
+// persistent datastructure... the core of the infrastructure
+class FrameSeries
+{
+public:
+        FrameSeries()
+        {
+                setBudget(FrameSeriesBudget {});
+        }
+
+        void beginFrame()
+        {
+                recordFrameStats();
+
+                // the host may have touched the GL state between frames
+                glstate::invalidate();
+
+                // we should invalidate arrays so as to garbage
+                // collect / recycle the now un-needed definitions
+                reset(framebufferHeap);
+                reset(meshHeap);
+                reset(textureHeap);
+                reset(programHeap);
+
+                // framebuffers go first, as they release their textures
+                trim(framebufferHeap, [this](size_t index) {
+                        auto const& texture = framebufferHeap.resources[index].texture;
+                        auto textureIndex = indexOf(textureHeap, texture);
+                        if (textureIndex != NOT_FOUND) {
+                                evict(textureHeap, textureIndex);
+                        }
+                });
+                trim(textureHeap, [](size_t) {});
+                trim(meshHeap, [](size_t) {});
+                trim(programHeap, [](size_t) {});
+
+                // every scratch target returns to the pool
+                scratchTargets.erase(std::remove_if(std::begin(scratchTargets),
+                                                    std::end(scratchTargets),
+                [this](ScratchTarget const& target) {
+                        return indexOf(framebufferHeap, target.handle) == NOT_FOUND;
+                }), std::end(scratchTargets));
+                for (auto& target : scratchTargets) {
+                        target.inUse = false;
+                }
+        }
+
+        FrameSeriesStats frameStats() const
+        {
+                if (statsHistory.empty()) {
+                        return {};
+                }
+                return statsHistory[(statsHistoryStart + statsHistory.size() - 1)
+                                    % statsHistory.size()];
+        }
+
+        std::vector<FrameSeriesStats> frameStatsHistory() const
+        {
+                auto history = std::vector<FrameSeriesStats> {};
+                history.reserve(statsHistory.size());
+                for (size_t i = 0; i < statsHistory.size(); i++) {
+                        history.push_back(statsHistory[(statsHistoryStart + i)
+                                                       % statsHistory.size()]);
+                }
+                return history;
+        }
+
+        FrameSeriesStats totalStats() const
+        {
+                auto stats = frameStats();
+                stats.textures = total(textureHeap, stats.textures);
+                stats.framebuffers = total(framebufferHeap, stats.framebuffers);
+                stats.meshes = total(meshHeap, stats.meshes);
+                stats.programs = total(programHeap, stats.programs);
+                stats.stateCalls = totalStateCounters.calls;
+                stats.redundantStateCalls = totalStateCounters.redundantCalls;
+                return stats;
+        }
+
+        void setBudget(FrameSeriesBudget const& budget)
+        {
+                framebufferHeap.byteBudget = budget.framebufferBytes;
+                textureHeap.byteBudget = budget.textureBytes;
+                meshHeap.byteBudget = budget.bufferBytes;
+                for (auto idleFrameCount : {
+                                &framebufferHeap.idleFrameCount,
+                                &textureHeap.idleFrameCount,
+                                &meshHeap.idleFrameCount,
+                                &programHeap.idleFrameCount,
+                        }) {
+                        *idleFrameCount = budget.idleFrameCount;
+                }
+        }
+
+        void setProgramBinaryDirectory(std::string const& directory)
+        {
+                programBinaries = estd::make_unique<ProgramBinaryCache>(directory);
+        }
+
+        /// copied out on every draw, thus without the definition
+        struct FramebufferMaterials {
+                GLuint framebufferId;
+                int width;
+                int height;
+        };
+
+        /// @param textureDef set to the definition of its texture
+        FramebufferMaterials framebuffer(FramebufferDef const& framebufferDef,
+                                         TextureDef& textureDef)
+        {
+                auto const index = framebufferIndex(framebufferDef);
+                textureDef = framebufferHeap.resources[index].textureDef;
+                return framebufferMaterials(index);
+        }
+
+        FramebufferMaterials framebuffer(TargetHandle target)
+        {
+                auto index = resolveTarget(target);
+                if (index == NOT_FOUND) {
+                        return { 0, 0, 0 };
+                }
+                return framebufferMaterials(index);
+        }
+
+        /**
+         * whether some of the objects sample the texture of the target,
+         * be it by handle or by the definition drawManyIntoTexture
+         * returned.
+         */
+        bool samplesTarget(TargetHandle target, RenderObjects objects) const
+        {
+                auto const index = indexOf(framebufferHeap, target);
+                if (index == NOT_FOUND) {
+                        return false;
+                }
+
+                auto const texture = indexOf(textureHeap, framebufferHeap.resources[index].texture);
+                if (texture == NOT_FOUND) {
+                        return false;
+                }
+                return std::any_of(std::begin(objects), std::end(objects),
+                [this, texture](RenderObjectDef const& object) {
+                        return std::any_of(std::begin(object.inputs.textures),
+                                           std::end(object.inputs.textures),
+                        [this, texture](ProgramInputs::TextureInput const& input) {
+                                return sampledTextureIndex(input) == texture;
+                        });
+                });
+        }
+
+        /// entry of the texture an input samples, when it already exists
+        size_t sampledTextureIndex(ProgramInputs::TextureInput const& input) const
+        {
+                if (input.texture.defined()) {
+                        return indexOf(textureHeap, input.texture);
+                }
+                // only framebuffer attachments are defined this way
+                if (input.content.pixelFiller != framebufferPixelFiller) {
+                        return NOT_FOUND;
+                }
+                return findDef(textureHeap, input.content, hashOf(input.content));
+        }
+
+        /**
+         * separate the texture a pass samples from the one it draws
+         * into, for passes sampling their own target.
+         *
+         * passes clearing their target draw into a second allocation,
+         * which replaces the first one on endFeedback. Other passes
+         * keep drawing over the current content, and sample a copy.
+         */
+        void beginFeedback(TargetHandle target, bool clears)
+        {
+                auto const index = indexOf(framebufferHeap, target);
+                if (index == NOT_FOUND) {
+                        return;
+                }
+
+                auto& framebuffer = framebufferHeap.resources[index];
+                auto const& def = framebuffer.textureDef;
+                if (!framebuffer.hasFeedback) {
+                        createRenderTargetFramebuffer(framebuffer.feedbackResource,
+                                                      framebuffer.feedbackTexture,
+                                                      framebuffer.hasDepth
+                                                      ? &framebuffer.feedbackDepthbuffer
+                                                      : nullptr,
+                                                      { def.width, def.height },
+                                                      framebuffer.internalFormat);
+                        framebuffer.hasFeedback = true;
+                        setEntryBytes(framebufferHeap, index, 2 * framebufferBytes(framebuffer));
+                }
+
+                if (clears) {
+                        std::swap(framebuffer.resource.id, framebuffer.feedbackResource.id);
+                        std::swap(framebuffer.depthbuffer.id,
+                                  framebuffer.feedbackDepthbuffer.id);
+                        return;
+                }
+
+                glstate::bindFramebuffer(framebuffer.resource.id);
+                glstate::bindTexture(GL_TEXTURE_2D, framebuffer.feedbackTexture.id);
+                glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, def.width, def.height);
+                swapFeedbackTexture(framebuffer);
+        }
+
+        /// the texture of the target is again the one drawn into
+        void endFeedback(TargetHandle target)
+        {
+                auto const index = indexOf(framebufferHeap, target);
+                if (index == NOT_FOUND) {
+                        return;
+                }
+                swapFeedbackTexture(framebufferHeap.resources[index]);
+        }
+
+        /// a free pooled target of this kind, or a new one
+        TargetHandle scratchTarget(ScratchTargetDef const& def)
+        {
+                for (auto& target : scratchTargets) {
+                        if (target.inUse
+                            || target.def.width != def.width
+                            || target.def.height != def.height
+                            || target.def.format != def.format
+                            || target.def.depth != def.depth) {
+                                continue;
+                        }
+                        if (resolveTarget(target.handle) == NOT_FOUND) {
+                                // released by the budget, dropped next frame
+                                continue;
+                        }
+                        target.inUse = true;
+                        return target.handle;
+                }
+
+                auto const internalFormat =
+                        def.format == ScratchTargetDef::RGBA8 ? GL_RGBA8 : GL_RGBA16F;
+                auto const index = framebufferIndex(FramebufferDef {
+                        {}, def.width, def.height, 0, nullptr
+                }, internalFormat, def.depth);
+                auto const handle = handleAt<TargetHandle>(framebufferHeap, index);
+                scratchTargets.push_back({ def, handle, true });
+                return handle;
+        }
+
+        void releaseScratchTarget(TargetHandle handle)
+        {
+                for (auto& target : scratchTargets) {
+                        if (target.handle.slot == handle.slot
+                            && target.handle.generation == handle.generation) {
+                                target.inUse = false;
+                                return;
+                        }
+                }
+        }
+
+        TargetHandle defineTarget(FramebufferDef const& framebufferDef)
+        {
+                return handleAt<TargetHandle>(framebufferHeap,
+                                              framebufferIndex(framebufferDef));
+        }
+
+        TextureHandle targetTexture(TargetHandle target)
+        {
+                auto index = resolveTarget(target);
+                if (index == NOT_FOUND) {
+                        return {};
+                }
+                return framebufferHeap.resources[index].texture;
+        }
+
+        struct MeshMaterials {
+                VertexArrayCache* vertexArrays;
+                size_t indicesCount;
+                GLuint indicesBuffer;
+                /// in bytes, within indicesBuffer
+                size_t indicesOffset;
+                GLuint vertexBuffer;
+                /// each array, within vertexBuffer
+                GeometryArena::Range const* arrays;
+                size_t arrayCount;
+                uint64_t storageGeneration;
+        };
+
+        /// working memory of draws, kept from one draw to the next
+        struct DrawScratch {
+                struct Item {
+                        ProgramInputs const* inputs;
+                        ProgramBindings const* bindings;
+                        MeshMaterials mesh;
+                        uint64_t texturesKey;
+                };
+                struct Batch {
+                        size_t first;
+                        size_t last;
+                        /// into blockOffsets
+                        size_t firstBlock;
+                };
+
+                std::vector<Item> items;
+                std::vector<Batch> batches;
+                std::vector<size_t> blockOffsets;
+                std::vector<ProgramInputs const*> instances;
+                std::vector<float> instanceData;
+                /// objects of a recorded command being executed
+                std::vector<RenderObjectDef> recordedObjects;
+        };
+
+        DrawScratch& drawScratch()
+        {
+                return scratch;
+        }
+
+        MeshMaterials mesh(GeometryDef const& geometryDef)
+        {
+                return meshMaterials(meshIndex(geometryDef));
+        }
+
+        MeshMaterials mesh(MeshHandle mesh)
+        {
+                auto index = resolve(meshHeap, mesh);
+                if (index == NOT_FOUND) {
+                        return { nullptr, 0, 0, 0, 0, nullptr, 0, 0 };
+                }
+                return meshMaterials(index);
+        }
+
+        MeshHandle defineMesh(GeometryDef const& geometryDef)
+        {
+                return handleAt<MeshHandle>(meshHeap, meshIndex(geometryDef));
+        }
+
+        struct TextureMaterials {
+                GLuint textureId;
+                GLenum target;
+        };
+
+        TextureMaterials texture(TextureDef const& textureDef)
+        {
+                return textureMaterials(textureIndex(textureDef));
+        }
+
+        TextureMaterials texture(TextureHandle texture)
+        {
+                auto index = resolve(textureHeap, texture);
+                if (index == NOT_FOUND) {
+                        return { 0, 0 };
+                }
+                return textureMaterials(index);
+        }
+
+        TextureHandle defineTexture(TextureDef const& textureDef)
+        {
+                return handleAt<TextureHandle>(textureHeap,
+                                               textureIndex(textureDef));
+        }
+
+        struct ShaderProgramMaterials {
+                GLuint programId;
+                ProgramReflection* reflection;
+        };
+
+        /// the variant of the program for the constant inputs
+        ShaderProgramMaterials program(InternedProgramDef const& programDef,
+                                       ProgramInputs const& inputs)
+        {
+                return programMaterials(variantIndex(programIndex(programDef), inputs));
+        }
+
+        ShaderProgramMaterials program(ProgramHandle program, ProgramInputs const& inputs)
+        {
+                auto index = resolve(programHeap, program);
+                if (index == NOT_FOUND) {
+                        return { 0, nullptr };
+                }
+                return programMaterials(variantIndex(index, inputs));
+        }
 
-// persistent datastructure... the core of the infrastructure
-class FrameSeries
-{
-public:
-        ~FrameSeries()
+        ProgramHandle defineProgram(InternedProgramDef const& programDef)
         {
-                printf("summary:\n");
-                printf("program creations: %ld\n", programCreations);
-                printf("texture creations: %ld\n", textureCreations);
-                printf("mesh creations: %ld\n"
-                       "meshes: %ld\n",
-                       meshCreations,
-                       meshes.size());
-                printf("framebuffer creations: %ld\n"
-                       "framebuffers: %ld\n",
-                       framebufferCreations,
-                       framebuffers.size());
+                return handleAt<ProgramHandle>(programHeap,
+                                               programIndex(programDef));
         }
 
-        void beginFrame()
+        /// per instance inputs of the draws
+        StreamBuffer& instanceStream()
         {
-                // we should invalidate arrays so as to garbage
-                // collect / recycle the now un-needed definitions
-                reset(framebufferHeap);
-                reset(meshHeap);
-                reset(textureHeap);
-                reset(programHeap);
+                return instances;
         }
 
-        struct FramebufferMaterials {
-                GLuint framebufferId;
+        /// uniform block data of the draws
+        UniformBufferRing& uniformRing()
+        {
+                return uniforms;
+        }
+
+private:
+        struct Mesh {
+                /// stable across heap reordering, for materials
+                std::unique_ptr<VertexArrayCache> vertexArrays;
+                size_t indicesCount = 0;
+                GeometryArena::Range indices;
+                std::vector<GeometryArena::Range> arrays;
+        };
+
+        struct Framebuffer {
+                FramebufferResource resource;
+                RenderbufferResource depthbuffer;
                 TextureDef textureDef;
+                /// color attachment, owned by the texture heap
+                TextureHandle texture;
+                GLenum internalFormat = GL_RGBA16F;
+                bool hasDepth = true;
+
+                /// second allocation, for passes sampling their target
+                bool hasFeedback = false;
+                FramebufferResource feedbackResource;
+                TextureResource feedbackTexture;
+                RenderbufferResource feedbackDepthbuffer;
+        };
+
+        struct Texture {
+                TextureResource resource;
+                GLenum target;
+        };
+
+        /// a compiled shader, shared by the programs linking it
+        template <typename ShaderResource>
+        struct ShaderStage {
+                std::string source;
+                ShaderResource shader;
+        };
+
+        /// by source hash, alive while a program links the stage
+        template <typename ShaderResource>
+        using ShaderStages =
+                std::unordered_multimap<uint64_t,
+                std::weak_ptr<ShaderStage<ShaderResource>>>;
+
+        /// a program specialized for some constant inputs
+        struct ProgramVariant {
+                uint64_t constantsHash;
+                ProgramInputs constants;
+                InternedProgramDef def;
+        };
+
+        struct Program {
+                /// unset for programs loaded from their binary
+                std::shared_ptr<ShaderStage<VertexShaderResource>> vertexStage;
+                std::shared_ptr<ShaderStage<FragmentShaderResource>> fragmentStage;
+                ShaderProgramResource program;
+                /// compiled and linked on first use
+                bool submitted = false;
+                /// programs are only used once the driver is done linking
+                LinkStatus status = LINK_PENDING;
+                /// released with the program
+                std::vector<ProgramVariant> variants;
+                /// stable across heap reordering, for materials
+                std::unique_ptr<ProgramReflection> reflection;
         };
 
-        FramebufferMaterials framebuffer(FramebufferDef framebufferDef)
+        size_t framebufferIndex(FramebufferDef const& framebufferDef,
+                                GLenum internalFormat = GL_RGBA16F,
+                                bool hasDepth = true)
         {
-                auto fbIndex = findOrCreate<FramebufferDef>
+                auto fbIndex = findOrCreate
                                (framebufferHeap,
                                 framebufferDef,
-                [&framebufferDef](FramebufferDef const& element) {
-                        return isEqual(element, framebufferDef);
-                },
                 [=](FramebufferDef const& def, size_t framebufferIndex) {
-                        framebuffers.resize(1 + framebufferIndex);
-
-                        auto& framebuffer = framebuffers[framebufferIndex];
-
-                        auto txIndex = findOrCreate<TextureDef>
+                        auto txIndex = findOrCreate
                                        (textureHeap,
                                         framebufferDef,
-                        [&framebufferDef](TextureDef const& element) {
-                                return isEqual(element, framebufferDef);
-                        },
-                        [=](TextureDef const& def, size_t index) {
-                                textures.resize(index + 1);
-                        },
-                        [=](size_t indexA, size_t indexB) {
-                                std::swap(textures[indexA], textures[indexB]);
-                        }
-                                       );
+                        [](TextureDef const&, size_t) {});
 
-                        auto& texture = textures[txIndex];
+                        auto& framebuffer = framebufferHeap.resources[framebufferIndex];
+                        auto& texture = textureHeap.resources[txIndex];
                         texture.target = GL_TEXTURE_2D;
+                        // redefined on first use, to the new size
+                        framebuffer.hasFeedback = false;
+                        framebuffer.internalFormat = internalFormat;
+                        framebuffer.hasDepth = hasDepth;
 
-                        createImageCaptureFramebuffer(framebuffer.resource, texture.resource,
-                                                      framebuffer.depthbuffer, { framebufferDef.width, framebufferDef.height });
-                        framebufferCreations++;
+                        createRenderTargetFramebuffer(framebuffer.resource, texture.resource,
+                                                      hasDepth ? &framebuffer.depthbuffer : nullptr,
+                                                      { framebufferDef.width, framebufferDef.height },
+                                                      internalFormat);
 
                         auto textureDef = framebufferDef;
                         textureDef.data.resize(sizeof(GLint));
                         *((GLint*) &textureDef.data.front()) = framebuffer.resource.id;
                         textureDef.pixelFiller = framebufferPixelFiller;
 
-                        textureDefs[txIndex] = textureDef;
+                        redefine(textureHeap, txIndex, textureDef);
                         framebuffer.textureDef = textureDef;
-                        framebufferDefs[framebufferIndex] = textureDef;
-                },
-                [=](size_t indexA, size_t indexB) {
-                        std::swap(framebuffers[indexA], framebuffers[indexB]);
+                        framebuffer.texture = handleAt<TextureHandle>(textureHeap, txIndex);
+                        redefine(framebufferHeap, framebufferIndex, textureDef);
+
+                        setEntryBytes(framebufferHeap, framebufferIndex,
+                                      framebufferBytes(framebuffer));
+                        setEntryBytes(textureHeap, txIndex, 0);
                 });
 
-                auto const& framebuffer = framebuffers[fbIndex];
-                return { framebuffer.resource.id, framebuffer.textureDef };
+                // the color attachment lives as long as its framebuffer
+                resolve(textureHeap, framebufferHeap.resources[fbIndex].texture);
+
+                return fbIndex;
         }
 
-        struct MeshMaterials {
-                GLuint vertexArray;
-                size_t indicesCount;
-                GLuint indicesBuffer;
-                std::vector<GLuint> vertexBuffers;
-        };
+        // returns the index of a live target, marking it and its color
+        // attachment as used
+        size_t resolveTarget(TargetHandle target)
+        {
+                auto const index = resolve(framebufferHeap, target);
+                if (index != NOT_FOUND) {
+                        resolve(textureHeap, framebufferHeap.resources[index].texture);
+                }
+                return index;
+        }
+
+        /// storage of the color and depth attachments
+        static size_t framebufferBytes(Framebuffer const& framebuffer)
+        {
+                auto const& def = framebuffer.textureDef;
+                auto const pixelCount = size_t(def.width) * size_t(def.height);
+                auto const colorBytes = framebuffer.internalFormat == GL_RGBA8 ? 4 : 8;
+                return pixelCount * (colorBytes + (framebuffer.hasDepth ? 4 : 0));
+        }
 
-        MeshMaterials mesh(GeometryDef geometryDef)
+        void swapFeedbackTexture(Framebuffer& framebuffer)
         {
-                auto meshIndex = findOrCreate<GeometryDef>
-                                 (meshHeap,
-                                  geometryDef,
-                [&geometryDef](GeometryDef const& element) {
-                        return element.data == geometryDef.data
-                               && element.definer == geometryDef.definer
-                               && element.arrayCount == geometryDef.arrayCount;
-                },
+                auto const txIndex = indexOf(textureHeap, framebuffer.texture);
+                if (txIndex == NOT_FOUND) {
+                        return;
+                }
+                std::swap(textureHeap.resources[txIndex].resource.id,
+                          framebuffer.feedbackTexture.id);
+        }
+
+        FramebufferMaterials framebufferMaterials(size_t index)
+        {
+                auto const& framebuffer = framebufferHeap.resources[index];
+                return {
+                        framebuffer.resource.id,
+                        framebuffer.textureDef.width,
+                        framebuffer.textureDef.height,
+                };
+        }
+
+        size_t meshIndex(GeometryDef const& geometryDef)
+        {
+                return findOrCreate
+                       (meshHeap,
+                        geometryDef,
                 [=](GeometryDef const& def, size_t meshIndex) {
-                        meshes.resize(1 + meshIndex);
+                        auto& mesh = meshHeap.resources[meshIndex];
+                        // layouts refer to the previous storage
+                        mesh.vertexArrays = estd::make_unique<VertexArrayCache>();
+                        mesh.indicesCount = 0;
+                        mesh.indices = {};
+                        mesh.arrays.clear();
 
-                        auto& mesh = meshes[meshIndex];
+                        auto bytes = size_t(0);
                         if (def.definer) {
-                                mesh.vertexBuffers.resize(def.arrayCount);
+                                // defined in scratch buffers, then packed in the arena
+                                if (scratchArrays.size() < def.arrayCount) {
+                                        scratchArrays.resize(def.arrayCount);
+                                }
                                 mesh.indicesCount = def.definer
-                                                    (mesh.indices,
-                                                     &mesh.vertexBuffers.front(),
+                                                    (scratchIndices,
+                                                     &scratchArrays.front(),
                                                      &def.data.front());
-                        }
-
-                        meshCreations++;
-                },
-                [=](size_t indexA, size_t indexB) {
-                        std::swap(meshes.at(indexA), meshes.at(indexB));
-                });
 
-                auto const& mesh = meshes.at(meshIndex);
-                auto vertexBufferIds = std::vector<GLuint> {};
-                std::transform(std::begin(mesh.vertexBuffers),
-                               std::end(mesh.vertexBuffers),
-                               std::back_inserter(vertexBufferIds),
-                [](BufferResource const& element) {
-                        return element.id;
+                                mesh.indices = geometryArena.store(GeometryArena::INDICES,
+                                                                   scratchIndices,
+                                                                   bufferBytes(scratchIndices));
+                                bytes += mesh.indices.size;
+                                for (size_t i = 0; i < def.arrayCount; i++) {
+                                        auto const& scratch = scratchArrays[i];
+                                        mesh.arrays.push_back(
+                                                geometryArena.store(GeometryArena::VERTICES,
+                                                                    scratch,
+                                                                    bufferBytes(scratch)));
+                                        bytes += mesh.arrays.back().size;
+                                }
+                        }
+                        setEntryBytes(meshHeap, meshIndex, bytes);
                 });
+        }
 
+        MeshMaterials meshMaterials(size_t index)
+        {
+                auto const& mesh = meshHeap.resources.at(index);
                 return {
-                        mesh.vertexArray.id,
+                        mesh.vertexArrays.get(),
                         mesh.indicesCount,
-                        mesh.indices.id,
-                        vertexBufferIds
+                        geometryArena.buffer(GeometryArena::INDICES),
+                        mesh.indices.offset,
+                        geometryArena.buffer(GeometryArena::VERTICES),
+                        mesh.arrays.data(),
+                        mesh.arrays.size(),
+                        geometryArena.storageGeneration(),
                 };
         }
 
-        struct TextureMaterials {
-                GLuint textureId;
-                GLenum target;
-        };
-
-        TextureMaterials texture(TextureDef textureDef)
+        size_t textureIndex(TextureDef const& textureDef)
         {
-                auto index = findOrCreate<TextureDef>(textureHeap,
-                                                      textureDef,
-                [&textureDef](TextureDef const& element) {
-                        return isEqual(element, textureDef);
-                },
+                return findOrCreate
+                       (textureHeap,
+                        textureDef,
                 [=](TextureDef const& def, size_t index) {
-                        textures.resize(index + 1);
-                        auto& texture = textures[index];
+                        auto& texture = textureHeap.resources[index];
 
                         if (def.width > 0 && def.height > 0 && def.depth > 0) {
                                 texture.target = GL_TEXTURE_3D;
@@ -198,7 +1413,7 @@ public:
                         OGL_TRACE;
                         switch(texture.target) {
                         case GL_TEXTURE_2D:
-                                glBindTexture(texture.target, texture.resource.id);
+                                glstate::bindTexture(texture.target, texture.resource.id);
                                 if (!def.pixelFiller) {
                                         break;
                                 }
@@ -209,7 +1424,7 @@ public:
                                 });
                                 break;
                         case GL_TEXTURE_3D:
-                                glBindTexture(texture.target, texture.resource.id);
+                                glstate::bindTexture(texture.target, texture.resource.id);
                                 if (!def.pixelFiller) {
                                         break;
                                 }
@@ -221,167 +1436,622 @@ public:
                                 });
                                 break;
                         };
-                        glBindTexture(texture.target, 0);
                         OGL_TRACE;
-                        textureCreations++;
-                },
-                [=](size_t indexA, size_t indexB) {
-                        std::swap(textures[indexA], textures[indexB]);
-                });
 
-                auto const& texture = textures[index];
+                        auto bytes = size_t(0);
+                        if (texture.target) {
+                                bytes = size_t(4) * size_t(def.width)
+                                        * size_t(std::max(def.height, 1))
+                                        * size_t(std::max(def.depth, 1));
+                        }
+                        setEntryBytes(textureHeap, index, bytes);
+                });
+        }
 
+        TextureMaterials textureMaterials(size_t index)
+        {
+                auto const& texture = textureHeap.resources[index];
                 return { texture.resource.id, texture.target };
         }
 
-        struct ShaderProgramMaterials {
-                GLuint programId;
-        };
-
-        ShaderProgramMaterials program(ProgramDef programDef)
-        {
-                auto index = findOrCreate<ProgramDef>
-                             (programHeap,
-                              programDef,
-                [&programDef](ProgramDef const& element) {
-                        return element.fragmentShader.source
-                               == programDef.fragmentShader.source
-                               && element.vertexShader.source
-                               == programDef.vertexShader.source;
-                },
-                [=](ProgramDef const& def, size_t index) {
-                        programs.resize(index + 1);
-                        vertexShaders.resize(index + 1);
-                        fragmentShaders.resize(index + 1);
-
-                        auto& program = programs[index];
-                        auto& vertexShader = vertexShaders[index];
-                        auto& fragmentShader = fragmentShaders[index];
-
-                        compile(vertexShader, programDef.vertexShader.source);
-                        compile(fragmentShader, programDef.fragmentShader.source);
-                        link(program, vertexShader, fragmentShader);
+        size_t programIndex(InternedProgramDef const& programDef)
+        {
+                return findOrCreate
+                       (programHeap,
+                        programDef,
+                [=](InternedProgramDef const& def, size_t index) {
+                        auto& program = programHeap.resources[index];
 
-                        OGL_TRACE;
-                        programCreations++;
-                },
-                [=](size_t indexA, size_t indexB) {
-                        std::swap(programs[indexA], programs[indexB]);
-                        std::swap(vertexShaders[indexA], vertexShaders[indexB]);
-                        std::swap(fragmentShaders[indexA], fragmentShaders[indexB]);
+                        // linked and reflected on first use, see programMaterials
+                        program.reflection.reset();
+                        detachStages(program);
+                        program.variants.clear();
+                        program.submitted = false;
+                        program.status = LINK_PENDING;
                 });
-
-                return { programs[index].id };
         }
 
-private:
-        // returns index to use (and create an entry if missing)
-        template <typename ResourceDef>
-        size_t findOrCreateDef(std::vector<ResourceDef>& definitions,
-                               ResourceDef const& def,
-                               std::function<bool(ResourceDef const&)> isDef,
-                               size_t firstRecyclableIndex)
+        /// load the program from its binary, or compile and link it
+        void submitProgram(size_t index)
         {
-                auto existing =
-                        std::find_if(std::begin(definitions),
-                                     std::end(definitions),
-                                     isDef);
+                auto& program = programHeap.resources[index];
+                auto const& def = *programHeap.definitions[index].def;
+                auto const& vertexSource = def.vertexShader.source;
+                auto const& fragmentSource = def.fragmentShader.source;
 
-                if (existing != std::end(definitions)) {
-                        return &(*existing) - &definitions.front();
-                } else {
-                        auto index = firstRecyclableIndex;
-                        if (index >= definitions.size()) {
-                                definitions.resize(1 + index);
+                program.submitted = true;
+                if (programBinaries
+                    && programBinaries->load(program.program, vertexSource,
+                                             fragmentSource)) {
+                        program.status = LINK_SUCCEEDED;
+                        return;
+                }
+                program.vertexStage = shaderStage(vertexStages, vertexSource);
+                program.fragmentStage = shaderStage(fragmentStages, fragmentSource);
+                submitLink(program.program, program.vertexStage->shader,
+                           program.fragmentStage->shader);
+                program.status = LINK_PENDING;
+
+                OGL_TRACE;
+        }
+
+        /// the stage compiled from source, compiling it when missing
+        template <typename ShaderResource>
+        static std::shared_ptr<ShaderStage<ShaderResource>> shaderStage
+                        (ShaderStages<ShaderResource>& stages, std::string const& source)
+        {
+                auto const hash = fnv1a(source.data(), source.size());
+                auto range = stages.equal_range(hash);
+                for (auto entry = range.first; entry != range.second;) {
+                        auto existing = entry->second.lock();
+                        if (!existing) {
+                                entry = stages.erase(entry);
+                                continue;
+                        }
 
+                        if (existing->source == source) {
+                                return existing;
                         }
-                        definitions[index] = def;
+                        ++entry;
+                }
+
+                auto stage = std::make_shared<ShaderStage<ShaderResource>>();
+                stage->source = source;
+                submitCompile(stage->shader, source);
+                stages.emplace(hash, stage);
+
+                return stage;
+        }
+
+        /**
+         * index of the program specialized for the constant inputs.
+         *
+         * the base program is only read from, and never linked when
+         * all its draws have constants.
+         */
+        size_t variantIndex(size_t index, ProgramInputs const& inputs)
+        {
+                if (!hasConstants(inputs)) {
                         return index;
                 }
+
+                auto const hash = constantsHashOf(inputs, FNV1A_BASIS);
+                auto& variants = programHeap.resources[index].variants;
+                for (auto const& variant : variants) {
+                        if (variant.constantsHash == hash
+                            && haveSameConstants(variant.constants, inputs)) {
+                                // copied out, as programIndex reorders the heap
+                                auto const def = variant.def;
+                                return programIndex(def);
+                        }
+                }
+
+                auto const& base = *programHeap.definitions[index].def;
+                auto const def = intern(specializedDef(base, inputs));
+                variants.push_back({ hash, constantsOf(inputs), def });
+                return programIndex(def);
+        }
+
+        /// for recycled programs to link other stages
+        static void detachStages(Program& program)
+        {
+                if (program.vertexStage) {
+                        glDetachShader(program.program.id, program.vertexStage->shader.id);
+                        program.vertexStage.reset();
+                }
+                if (program.fragmentStage) {
+                        glDetachShader(program.program.id, program.fragmentStage->shader.id);
+                        program.fragmentStage.reset();
+                }
+        }
+
+        /// the null program until linked, for draws to be skipped
+        ShaderProgramMaterials programMaterials(size_t index)
+        {
+                if (!programHeap.resources[index].submitted) {
+                        submitProgram(index);
+                }
+                auto& program = programHeap.resources[index];
+                if (program.status == LINK_PENDING) {
+                        program.status = pollLink(program.program,
+                                                  program.vertexStage->shader,
+                                                  program.fragmentStage->shader);
+                        if (program.status == LINK_SUCCEEDED && programBinaries) {
+                                auto const& def = *programHeap.definitions[index].def;
+                                programBinaries->store(program.program,
+                                                       def.vertexShader.source,
+                                                       def.fragmentShader.source);
+                        }
+                }
+                if (program.status != LINK_SUCCEEDED) {
+                        return { 0, nullptr };
+                }
+                if (!program.reflection) {
+                        reflect(program);
+                }
+                return { program.program.id, program.reflection.get() };
+        }
+
+        static void reflect(Program& program)
+        {
+                program.reflection = estd::make_unique<ProgramReflection>();
+                program.reflection->uniforms = activeUniforms(program.program);
+                program.reflection->attributes = activeAttributes(program.program);
+                program.reflection->uniformBlocks = activeUniformBlocks(program.program);
+                for (auto const& block : program.reflection->uniformBlocks) {
+                        glUniformBlockBinding(program.program.id, block.index,
+                                              block.index);
+                }
+
+                OGL_TRACE;
+        }
+
+        void recordFrameStats()
+        {
+                if (framebufferHeap.frame == 0) {
+                        // no frame has started yet
+                        return;
+                }
+
+                auto const stateCounters = glstate::counters();
+                glstate::resetCounters();
+
+                auto stats = FrameSeriesStats {};
+                stats.frame = framebufferHeap.frame;
+                stats.stateCalls = stateCounters.calls;
+                stats.redundantStateCalls = stateCounters.redundantCalls;
+                totalStateCounters.calls += stateCounters.calls;
+                totalStateCounters.redundantCalls += stateCounters.redundantCalls;
+                stats.textures = collect(textureHeap);
+                stats.framebuffers = collect(framebufferHeap);
+                stats.meshes = collect(meshHeap);
+                stats.programs = collect(programHeap);
+
+                if (statsHistory.size() < FRAME_STATS_HISTORY_SIZE) {
+                        statsHistory.push_back(stats);
+                } else {
+                        statsHistory[statsHistoryStart] = stats;
+                        statsHistoryStart = (statsHistoryStart + 1) % statsHistory.size();
+                }
+        }
+
+        static size_t bufferBytes(BufferResource const& buffer)
+        {
+                GLint size = 0;
+                withArrayBuffer(buffer, [&size]() {
+                        glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+                });
+                return size;
         }
 
-        template <typename ResourceDef>
+        /**
+         * definitions and their resources, ordered so that the ones
+         * used during the current frame come first, followed by those
+         * used in the previous frame, followed by the ones which can
+         * be recycled.
+         *
+         * slots give a stable identity to each entry, for handles.
+         *
+         * entries are evicted least recently used first when the heap
+         * goes over its byte budget, or when they have been idle for
+         * too long.
+         */
+        template <typename ResourceDef, typename Resource>
         struct RecyclingHeap {
-                size_t firstInactiveIndex;
-                size_t firstRecyclableIndex;
-                std::vector<ResourceDef>& definitions;
+                struct Slot {
+                        size_t index;
+                        uint32_t generation;
+                };
+
+                size_t firstInactiveIndex = 0;
+                size_t firstRecyclableIndex = 0;
+                std::vector<ResourceDef> definitions;
+                std::vector<Resource> resources;
+                /// content hash of each definition
+                std::vector<uint64_t> hashes;
+                /// definition indices by content hash
+                std::unordered_multimap<uint64_t, size_t> indices;
+                std::vector<uint32_t> slotOfIndex;
+                std::vector<Slot> slots;
+                std::vector<uint32_t> freeSlots;
+                /// estimated gpu storage of each entry
+                std::vector<size_t> entryBytes;
+                std::vector<uint64_t> lastUsedFrames;
+
+                uint64_t frame = 0;
+                size_t bytes = 0;
+                size_t byteBudget = ~size_t(0);
+                int idleFrameCount = FrameSeriesBudget {} .idleFrameCount;
+
+                /// counters of the current frame
+                FrameSeriesStats::Kind counts;
+                /// counters of all completed frames
+                FrameSeriesStats::Kind totalCounts;
         };
 
-        template <typename ResourceDef>
-        void reset(RecyclingHeap<ResourceDef>& heap)
+        static size_t const NOT_FOUND = ~size_t(0);
+
+        template <typename ResourceDef, typename Resource>
+        void reset(RecyclingHeap<ResourceDef, Resource>& heap)
         {
                 heap.firstRecyclableIndex = heap.firstInactiveIndex;
                 heap.firstInactiveIndex = 0;
+                heap.frame++;
         }
 
-        template <typename ResourceDef>
-        size_t findOrCreate(RecyclingHeap<ResourceDef>& heap,
-                            ResourceDef const& def,
-                            std::function<bool(ResourceDef const&)> isDef,
-                            std::function<void(ResourceDef const&,size_t)> createAt,
-                            std::function<void(size_t,size_t)> swap)
+        template <typename ResourceDef, typename Resource>
+        std::unordered_multimap<uint64_t, size_t>::iterator
+        findIndexEntry(RecyclingHeap<ResourceDef, Resource>& heap, size_t index)
+        {
+                auto range = heap.indices.equal_range(heap.hashes[index]);
+                for (auto entry = range.first; entry != range.second; ++entry) {
+                        if (entry->second == index) {
+                                return entry;
+                        }
+                }
+                return std::end(heap.indices);
+        }
+
+        // replaces the definition at index, keeping the hash index in sync
+        template <typename ResourceDef, typename Resource>
+        void redefine(RecyclingHeap<ResourceDef, Resource>& heap,
+                      size_t index,
+                      ResourceDef const& def,
+                      uint64_t hash)
+        {
+                auto entry = findIndexEntry(heap, index);
+                if (entry != std::end(heap.indices)) {
+                        heap.indices.erase(entry);
+                }
+                heap.definitions[index] = def;
+                heap.hashes[index] = hash;
+                heap.indices.emplace(hash, index);
+        }
+
+        template <typename ResourceDef, typename Resource>
+        void redefine(RecyclingHeap<ResourceDef, Resource>& heap,
+                      size_t index,
+                      ResourceDef const& def)
+        {
+                redefine(heap, index, def, hashOf(def));
+        }
+
+        template <typename ResourceDef, typename Resource>
+        void swapEntries(RecyclingHeap<ResourceDef, Resource>& heap,
+                         size_t indexA,
+                         size_t indexB)
+        {
+                auto entryA = findIndexEntry(heap, indexA);
+                auto entryB = findIndexEntry(heap, indexB);
+                entryA->second = indexB;
+                entryB->second = indexA;
+
+                std::swap(heap.definitions.at(indexA), heap.definitions.at(indexB));
+                std::swap(heap.resources.at(indexA), heap.resources.at(indexB));
+                std::swap(heap.hashes.at(indexA), heap.hashes.at(indexB));
+                std::swap(heap.slotOfIndex.at(indexA), heap.slotOfIndex.at(indexB));
+                std::swap(heap.entryBytes.at(indexA), heap.entryBytes.at(indexB));
+                std::swap(heap.lastUsedFrames.at(indexA), heap.lastUsedFrames.at(indexB));
+                heap.slots[heap.slotOfIndex[indexA]].index = indexA;
+                heap.slots[heap.slotOfIndex[indexB]].index = indexB;
+        }
+
+        template <typename ResourceDef, typename Resource>
+        void setEntryBytes(RecyclingHeap<ResourceDef, Resource>& heap,
+                           size_t index,
+                           size_t bytes)
+        {
+                heap.bytes -= heap.entryBytes[index];
+                heap.entryBytes[index] = bytes;
+                heap.bytes += bytes;
+        }
+
+        // take the counters of the frame that just ended
+        template <typename ResourceDef, typename Resource>
+        static FrameSeriesStats::Kind collect(RecyclingHeap<ResourceDef, Resource>& heap)
+        {
+                auto kind = heap.counts;
+                kind.liveCount = heap.resources.size();
+                kind.bytes = heap.bytes;
+
+                heap.totalCounts.hits += kind.hits;
+                heap.totalCounts.misses += kind.misses;
+                heap.totalCounts.creations += kind.creations;
+                heap.totalCounts.recycles += kind.recycles;
+                heap.totalCounts.evictions += kind.evictions;
+                heap.counts = {};
+
+                return kind;
+        }
+
+        template <typename ResourceDef, typename Resource>
+        static FrameSeriesStats::Kind total(RecyclingHeap<ResourceDef, Resource> const& heap,
+                                            FrameSeriesStats::Kind const& last)
+        {
+                auto kind = heap.totalCounts;
+                kind.liveCount = last.liveCount;
+                kind.bytes = last.bytes;
+                return kind;
+        }
+
+        /**
+         * destroy an entry and its resource, invalidating its handles.
+         *
+         * only valid between frames.
+         */
+        template <typename ResourceDef, typename Resource>
+        void evict(RecyclingHeap<ResourceDef, Resource>& heap, size_t index)
+        {
+                if (index < heap.firstRecyclableIndex) {
+                        // keep the entries used in the last frame contiguous
+                        auto const lastUsedIndex = heap.firstRecyclableIndex - 1;
+                        if (index != lastUsedIndex) {
+                                swapEntries(heap, index, lastUsedIndex);
+                        }
+                        index = lastUsedIndex;
+                        heap.firstRecyclableIndex--;
+                }
+
+                auto const lastIndex = heap.definitions.size() - 1;
+                if (index != lastIndex) {
+                        swapEntries(heap, index, lastIndex);
+                }
+
+                heap.indices.erase(findIndexEntry(heap, lastIndex));
+
+                auto const slot = heap.slotOfIndex[lastIndex];
+                heap.slots[slot].index = NOT_FOUND;
+                heap.slots[slot].generation++;
+                heap.freeSlots.push_back(slot);
+
+                heap.bytes -= heap.entryBytes[lastIndex];
+
+                heap.definitions.pop_back();
+                heap.resources.pop_back();
+                heap.hashes.pop_back();
+                heap.slotOfIndex.pop_back();
+                heap.entryBytes.pop_back();
+                heap.lastUsedFrames.pop_back();
+                heap.counts.evictions++;
+        }
+
+        /**
+         * evict entries not used during the last frame, least
+         * recently used first, until the heap fits in its budget and
+         * contains no idle entries.
+         */
+        template <typename ResourceDef, typename Resource, typename EvictFn>
+        void trim(RecyclingHeap<ResourceDef, Resource>& heap,
+                  EvictFn beforeEviction)
+        {
+                auto const isIdle = [&heap](size_t index) {
+                        return heap.frame - heap.lastUsedFrames[index]
+                               > uint64_t(heap.idleFrameCount);
+                };
+
+                auto const firstCandidate = heap.firstRecyclableIndex;
+                auto const lastCandidate = heap.definitions.size();
+                auto mustEvict = heap.bytes > heap.byteBudget;
+                for (auto index = firstCandidate; !mustEvict && index < lastCandidate; index++) {
+                        mustEvict = isIdle(index);
+                }
+                if (!mustEvict) {
+                        return;
+                }
+
+                auto candidateSlots = std::vector<uint32_t> {};
+                for (auto index = firstCandidate; index < lastCandidate; index++) {
+                        candidateSlots.push_back(heap.slotOfIndex[index]);
+                }
+                std::sort(std::begin(candidateSlots), std::end(candidateSlots),
+                [&heap](uint32_t slotA, uint32_t slotB) {
+                        return heap.lastUsedFrames[heap.slots[slotA].index]
+                               < heap.lastUsedFrames[heap.slots[slotB].index];
+                });
+
+                for (auto slot : candidateSlots) {
+                        auto const index = heap.slots[slot].index;
+                        if (index == NOT_FOUND) {
+                                // already released along another resource
+                                continue;
+                        }
+                        if (heap.bytes <= heap.byteBudget && !isIdle(index)) {
+                                break;
+                        }
+                        beforeEviction(index);
+                        evict(heap, heap.slots[slot].index);
+                }
+        }
+
+        // returns the index of def, or NOT_FOUND
+        template <typename ResourceDef, typename Resource>
+        size_t findDef(RecyclingHeap<ResourceDef, Resource> const& heap,
+                       ResourceDef const& def,
+                       uint64_t hash) const
         {
-                auto index = findOrCreateDef(heap.definitions,
-                                             def,
-                                             isDef,
-                                             heap.firstRecyclableIndex);
-                if (index == heap.firstRecyclableIndex) {
-                        heap.firstRecyclableIndex++;
-                        createAt(def, index);
+                auto range = heap.indices.equal_range(hash);
+                for (auto entry = range.first; entry != range.second; ++entry) {
+                        // full comparison only on hash match
+                        if (isEqual(heap.definitions[entry->second], def)) {
+                                return entry->second;
+                        }
+                }
+                return NOT_FOUND;
+        }
+
+        // returns index to use (and create an entry if missing)
+        template <typename ResourceDef, typename Resource>
+        size_t findOrCreateDef(RecyclingHeap<ResourceDef, Resource>& heap,
+                               ResourceDef const& def,
+                               bool& created)
+        {
+                auto const hash = hashOf(def);
+                auto const found = findDef(heap, def, hash);
+                if (found != NOT_FOUND) {
+                        heap.counts.hits++;
+                        created = false;
+                        return found;
+                }
+
+                heap.counts.misses++;
+                // entries activated this frame may have moved past the
+                // ones used in the last frame: never recycle those
+                auto index = std::max(heap.firstInactiveIndex, heap.firstRecyclableIndex);
+                if (index >= heap.definitions.size()) {
+                        heap.counts.creations++;
+                        heap.definitions.resize(1 + index);
+                        heap.resources.resize(1 + index);
+                        heap.hashes.resize(1 + index);
+                        heap.slotOfIndex.resize(1 + index);
+                        heap.entryBytes.resize(1 + index);
+                        heap.lastUsedFrames.resize(1 + index);
+                        heap.definitions[index] = def;
+                        heap.hashes[index] = hash;
+                        heap.indices.emplace(hash, index);
+                        if (heap.freeSlots.empty()) {
+                                heap.slotOfIndex[index] = heap.slots.size();
+                                heap.slots.push_back({ index, 0 });
+                        } else {
+                                auto const slot = heap.freeSlots.back();
+                                heap.freeSlots.pop_back();
+                                heap.slots[slot].index = index;
+                                heap.slotOfIndex[index] = slot;
+                        }
+                } else {
+                        heap.counts.recycles++;
+                        redefine(heap, index, def, hash);
+                        // handles to the previous definition are now stale
+                        heap.slots[heap.slotOfIndex[index]].generation++;
                 }
+                created = true;
+                return index;
+        }
 
+        // mark an entry as used during this frame, returns its new index
+        template <typename ResourceDef, typename Resource>
+        size_t activate(RecyclingHeap<ResourceDef, Resource>& heap, size_t index)
+        {
                 auto newIndex = index;
                 if (newIndex >= heap.firstInactiveIndex) {
                         if (newIndex != heap.firstInactiveIndex) {
                                 newIndex = heap.firstInactiveIndex;
-
-                                std::swap(heap.definitions.at(newIndex), heap.definitions.at(index));
-                                swap(newIndex, index);
+                                swapEntries(heap, newIndex, index);
                         }
 
                         heap.firstInactiveIndex++;
                 }
+                heap.lastUsedFrames[newIndex] = heap.frame;
 
                 return newIndex;
         }
 
-        struct Mesh {
-                VertexArrayResource vertexArray;
-                size_t indicesCount = 0;
-                BufferResource indices;
-                std::vector<BufferResource> vertexBuffers;
-        };
+        // createAt: void(ResourceDef const&, size_t index)
+        template <typename ResourceDef, typename Resource, typename CreateFn>
+        size_t findOrCreate(RecyclingHeap<ResourceDef, Resource>& heap,
+                            ResourceDef const& def,
+                            CreateFn createAt)
+        {
+                auto created = false;
+                auto index = findOrCreateDef(heap, def, created);
+                if (created) {
+                        heap.firstRecyclableIndex = index + 1;
+                        createAt(heap.definitions[index], index);
+                }
 
-        struct Framebuffer {
-                FramebufferResource resource;
-                RenderbufferResource depthbuffer;
-                TextureDef textureDef;
-        };
+                return activate(heap, index);
+        }
+
+        template <typename Handle, typename ResourceDef, typename Resource>
+        Handle handleAt(RecyclingHeap<ResourceDef, Resource> const& heap,
+                        size_t index)
+        {
+                auto const slot = heap.slotOfIndex[index];
+                auto handle = Handle {};
+                handle.slot = slot;
+                handle.generation = heap.slots[slot].generation;
+                return handle;
+        }
+
+        template <typename ResourceDef, typename Resource, typename Tag>
+        size_t indexOf(RecyclingHeap<ResourceDef, Resource> const& heap,
+                       ResourceHandle<Tag> handle) const
+        {
+                if (handle.slot >= heap.slots.size()) {
+                        return NOT_FOUND;
+                }
 
-        std::vector<Framebuffer> framebuffers;
-        std::vector<FramebufferDef> framebufferDefs;
-        RecyclingHeap<FramebufferDef> framebufferHeap = { 0, 0, framebufferDefs };
-        long framebufferCreations = 0;
+                auto const& slot = heap.slots[handle.slot];
+                if (slot.generation != handle.generation) {
+                        return NOT_FOUND;
+                }
 
-        std::vector<Mesh> meshes;
-        std::vector<GeometryDef> meshDefs;
-        RecyclingHeap<GeometryDef> meshHeap = { 0, 0, meshDefs };
-        long meshCreations = 0;
+                return slot.index;
+        }
 
-        struct Texture {
-                TextureResource resource;
-                GLenum target;
+        // returns the index of a live handle, marking it as used
+        template <typename ResourceDef, typename Resource, typename Tag>
+        size_t resolve(RecyclingHeap<ResourceDef, Resource>& heap,
+                       ResourceHandle<Tag> handle)
+        {
+                auto const index = indexOf(heap, handle);
+                if (index == NOT_FOUND) {
+                        heap.counts.misses++;
+                        return NOT_FOUND;
+                }
+
+                heap.counts.hits++;
+                return activate(heap, index);
+        }
+
+        /// outlives the meshes suballocated from it
+        GeometryArena geometryArena;
+        BufferResource scratchIndices;
+        std::vector<BufferResource> scratchArrays;
+
+        RecyclingHeap<FramebufferDef, Framebuffer> framebufferHeap;
+
+        /// framebuffers of the heap handed out as scratch targets
+        struct ScratchTarget {
+                ScratchTargetDef def;
+                TargetHandle handle;
+                bool inUse;
         };
+        std::vector<ScratchTarget> scratchTargets;
+        RecyclingHeap<GeometryDef, Mesh> meshHeap;
+        RecyclingHeap<TextureDef, Texture> textureHeap;
+        RecyclingHeap<InternedProgramDef, Program> programHeap;
+        /// when set, programs are loaded from their binary when possible
+        std::unique_ptr<ProgramBinaryCache> programBinaries;
+        ShaderStages<VertexShaderResource> vertexStages;
+        ShaderStages<FragmentShaderResource> fragmentStages;
+
+        /// ring of the last completed frames
+        std::vector<FrameSeriesStats> statsHistory;
+        size_t statsHistoryStart = 0;
+        glstate::Counters totalStateCounters;
+
+        StreamBuffer instances;
+        UniformBufferRing uniforms;
+        DrawScratch scratch;
 
-        std::vector<Texture> textures;
-        std::vector<TextureDef> textureDefs;
-        RecyclingHeap<TextureDef> textureHeap = { 0, 0, textureDefs };
-        long textureCreations = 0;
-
-        std::vector<VertexShaderResource> vertexShaders;
-        std::vector<FragmentShaderResource> fragmentShaders;
-        std::vector<ShaderProgramResource> programs;
-        std::vector<ProgramDef> programDefs;
-        RecyclingHeap<ProgramDef> programHeap = { 0, 0, programDefs };
-        long programCreations = 0;
 };
@@ -4,6 +4,8 @@
 
 #include <GL/glew.h>
 
+#include <cstring>
+
 class Buffer
 {
 public:
@@ -43,6 +45,53 @@ private:
         Buffer& operator=(Buffer const&)=delete;
 };
 
+/**
+ * storage for data rewritten every frame.
+ *
+ * written front to back with unsynchronized maps, and orphaned when
+ * full so that data still read by the GPU is never overwritten.
+ */
+class StreamBuffer
+{
+        ENFORCE_ID_OBJECT(StreamBuffer);
+public:
+        StreamBuffer(size_t capacity) : capacity(capacity), head(capacity) {}
+
+        //! @returns the offset of the data within the buffer, in bytes
+        size_t write(void const* data, size_t size)
+        {
+                auto const target = GL_COPY_WRITE_BUFFER;
+                auto offset = (head + 15) / 16 * 16;
+                glBindBuffer(target, buffer.ref);
+                if (offset + size > capacity) {
+                        if (size > capacity) {
+                                capacity = 2 * size;
+                        }
+                        glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+                        offset = 0;
+                }
+
+                auto destination = glMapBufferRange(target, offset, size,
+                                                    GL_MAP_WRITE_BIT
+                                                    | GL_MAP_INVALIDATE_RANGE_BIT
+                                                    | GL_MAP_UNSYNCHRONIZED_BIT);
+                if (destination) {
+                        std::memcpy(destination, data, size);
+                        glUnmapBuffer(target);
+                }
+                glBindBuffer(target, 0);
+
+                head = offset + size;
+                return offset;
+        }
+
+        Buffer buffer;
+
+private:
+        size_t capacity;
+        size_t head;
+};
+
 class VertexArray
 {
 public:
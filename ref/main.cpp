@@ -46,13 +46,21 @@ extern void render_next_gl3(uint64_t time_micros)
 
                 void run()
                 {
-                        std::lock_guard<std::mutex> lock(tasks_mtx);
-                        for (auto& task : tasks) {
+                        // unlocked while running, for tasks to add tasks
+                        std::vector<std::packaged_task<bool()>> running;
+                        {
+                                std::lock_guard<std::mutex> lock(tasks_mtx);
+                                std::swap(running, tasks);
+                        }
+                        for (auto& task : running) {
                                 std::future<bool> future = task.get_future();
                                 task();
-                                future.get();
+                                if (!future.get()) {
+                                        task.reset();
+                                        std::lock_guard<std::mutex> lock(tasks_mtx);
+                                        tasks.push_back(std::move(task));
+                                }
                         }
-                        tasks.clear();
                 }
 
                 std::mutex tasks_mtx;
@@ -135,6 +143,8 @@ extern void render_next_gl3(uint64_t time_micros)
         float const argb[4] = {
                 0.0f, 0.31f + 0.39f * sincos[0], 0.27f + 0.39f * sincos[1], 0.29f
         };
+        // defaults, for the depth mask to allow clearing
+        material_reset_state();
         glClearColor (argb[1], argb[2], argb[3], argb[0]);
         glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
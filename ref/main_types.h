@@ -7,6 +7,7 @@
 class DisplayThreadTasks
 {
 public:
+        /// tasks returning false are run again on the next frame
         virtual void add_task(std::function<bool()>&& task) = 0;
 };
 
@@ -23,34 +23,65 @@ void material_commit_with(MaterialImpl* material, int flags, float argb[4])
         material->flags = flags;
 }
 
+// shadow of the fragment state, to only send actual changes
+static struct FragmentState {
+        int blend = -1;
+        int depthTest = -1;
+        int depthMask = -1;
+        bool blendFuncSet = false;
+        bool depthFuncSet = false;
+} fragmentState;
+
+static void setCapability(int& cached, GLenum capability, bool enabled)
+{
+        if (cached == int(enabled)) {
+                return;
+        }
+        cached = enabled;
+        if (enabled) {
+                glEnable(capability);
+        } else {
+                glDisable(capability);
+        }
+}
+
+static void setDepthMask(bool enabled)
+{
+        if (fragmentState.depthMask == int(enabled)) {
+                return;
+        }
+        fragmentState.depthMask = enabled;
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
 void material_on(MaterialImpl* material)
 {
         auto flags = material->flags;
+        auto const depthTest = !(flags & MF_NO_DEPTH_TEST);
 
-        if (flags & MF_BLEND) {
-                glEnable(GL_BLEND);
+        setCapability(fragmentState.blend, GL_BLEND, flags & MF_BLEND);
+        if ((flags & MF_BLEND) && !fragmentState.blendFuncSet) {
                 glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-                glDisable (GL_DEPTH_TEST);
-                glDepthMask (GL_FALSE);
-        } else {
-                glDisable(GL_BLEND);
+                fragmentState.blendFuncSet = true;
         }
 
-        if (flags & MF_NO_DEPTH_TEST) {
-                glDisable (GL_DEPTH_TEST);
-                glDepthMask (GL_FALSE);
-        } else {
-                glEnable (GL_DEPTH_TEST);
-                glDepthMask (GL_TRUE);
+        setCapability(fragmentState.depthTest, GL_DEPTH_TEST, depthTest);
+        setDepthMask(depthTest);
+        if (depthTest && !fragmentState.depthFuncSet) {
                 glDepthFunc(GL_LESS);
+                fragmentState.depthFuncSet = true;
         }
 }
 
-void material_off(MaterialImpl* material)
+void material_off(MaterialImpl*)
 {
-        if (material->flags & MF_BLEND) {
-                glDisable(GL_BLEND);
-        }
-        glDisable (GL_DEPTH_TEST);
-        glDepthMask (GL_TRUE);
+        // the state is left for the next material, which sets all of it
+}
+
+void material_reset_state()
+{
+        fragmentState = FragmentState {};
+        setCapability(fragmentState.blend, GL_BLEND, false);
+        setCapability(fragmentState.depthTest, GL_DEPTH_TEST, false);
+        setDepthMask(true);
 }
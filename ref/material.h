@@ -20,6 +20,8 @@ std::unique_ptr<MaterialImpl, void (*)(MaterialImpl*)> material_make();
 void material_commit_with(MaterialImpl* material, int flags, float argb[4]);
 void material_on(MaterialImpl* material);
 void material_off(MaterialImpl* material);
+/// forget the cached state and return to defaults, e.g. at frame start
+void material_reset_state();
 
 class Material
 {
@@ -7,13 +7,20 @@ class MeshImpl
 {
 public:
         GLuint programRef;
-        Buffer vertices;
-        Buffer texcoords;
-        Buffer indices;
+        size_t verticesOffset;
+        size_t texcoordsOffset;
+        size_t indicesOffset;
         size_t indices_n;
         VertexArray array;
 };
 
+// meshes are redefined every frame, and share this storage
+static StreamBuffer& mesh_stream()
+{
+        static StreamBuffer stream(1 << 16);
+        return stream;
+}
+
 void mesh_delete(MeshImpl* mesh)
 {
         delete mesh;
@@ -29,8 +36,9 @@ void mesh_defquad2d (MeshImpl* g, int flags,
                      float x, float y, float w, float h,
                      float umin, float vmin, float umax, float vmax)
 {
+        auto& stream = mesh_stream();
+
         {
-                WithArrayBufferScope withVertices(g->vertices);
                 float vertices[] = {
                         x, y,
                         x, y + h,
@@ -38,11 +46,10 @@ void mesh_defquad2d (MeshImpl* g, int flags,
                         x + w, y,
                 };
 
-                glBufferData(GL_ARRAY_BUFFER, sizeof vertices, vertices, GL_STREAM_DRAW);
+                g->verticesOffset = stream.write(vertices, sizeof vertices);
         }
 
         {
-                WithArrayBufferScope withTexcoords(g->texcoords);
                 float texcoords[] = {
                         umin, vmin,
                         umin, vmax,
@@ -50,20 +57,16 @@ void mesh_defquad2d (MeshImpl* g, int flags,
                         umax, vmin,
                 };
 
-                glBufferData(GL_ARRAY_BUFFER, sizeof texcoords, texcoords, GL_STREAM_DRAW);
-
+                g->texcoordsOffset = stream.write(texcoords, sizeof texcoords);
         }
 
         {
-                WithElementArrayBufferScope withIndices(g->indices);
                 GLuint indices[] = {
                         0, 1, 2, 2, 3, 0,
                 };
 
                 g->indices_n = sizeof indices / sizeof indices[0];
-
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof indices, indices,
-                             GL_STREAM_DRAW);
+                g->indicesOffset = stream.write(indices, sizeof indices);
         }
 
 }
@@ -73,13 +76,14 @@ void mesh_bind(MeshImpl* self, GLuint positionAttribLoc,
 {
         WithVertexArrayScope withVertexArray(self->array);
 
-        glBindBuffer(GL_ARRAY_BUFFER, self->texcoords.ref);
-        glVertexAttribPointer(texcoordAttribLoc, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glBindBuffer(GL_ARRAY_BUFFER, self->vertices.ref);
-        glVertexAttribPointer(positionAttribLoc, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        auto const stream = mesh_stream().buffer.ref;
+        glBindBuffer(GL_ARRAY_BUFFER, stream);
+        glVertexAttribPointer(texcoordAttribLoc, 2, GL_FLOAT, GL_FALSE, 0,
+                              reinterpret_cast<GLvoid*> (self->texcoordsOffset));
+        glVertexAttribPointer(positionAttribLoc, 2, GL_FLOAT, GL_FALSE, 0,
+                              reinterpret_cast<GLvoid*> (self->verticesOffset));
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->indices.ref);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream);
         glEnableVertexAttribArray(positionAttribLoc);
         glEnableVertexAttribArray(texcoordAttribLoc);
 }
@@ -87,5 +91,6 @@ void mesh_bind(MeshImpl* self, GLuint positionAttribLoc,
 void mesh_draw(MeshImpl* self)
 {
         WithVertexArrayScope withVertexArray(self->array);
-        glDrawElements(GL_TRIANGLES, self->indices_n, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, self->indices_n, GL_UNSIGNED_INT,
+                       reinterpret_cast<GLvoid*> (self->indicesOffset));
 }
@@ -43,31 +43,29 @@ static void rdq (display_frame_t frame,
                 glClear (GL_COLOR_BUFFER_BIT);
         }
 
-        auto position_attrib = glGetAttribLocation(shader.ref(), "position");
-        auto texcoord_attrib = glGetAttribLocation(shader.ref(), "texcoord");
+        auto position_attrib = shader.attribLocation("position");
+        auto texcoord_attrib = shader.attribLocation("texcoord");
 
         quad.bind(position_attrib, texcoord_attrib);
 
-        glUseProgram(shader.ref());
+        useShaderProgram(shader.ref());
         quad.draw();
-        glUseProgram(0);
         OGL_TRACE;
 }
 
 static void shaderSetTransform(ShaderProgram const& shader, GLint loc,
                                matrix4 transform)
 {
-        WithShaderProgramScope withShader(shader);
-        glUniformMatrix4fv(loc, 1, GL_FALSE, transform);
-
+        shader.setUniformMatrix4fv(loc, transform);
 }
 
 static void shaderSetMaterial(ShaderProgram const& shader, GLint colorLoc,
                               Material const& material)
 {
-        WithShaderProgramScope withShader(shader);
-        glUniform4f(colorLoc,
-                    material.color[1], material.color[2], material.color[3], material.color[0]);
+        GLfloat const color[4] = {
+                material.color[1], material.color[2], material.color[3], material.color[0],
+        };
+        shader.setUniform4fv(colorLoc, color);
 }
 
 static void NF(Framebuffer& output, std::function <void ()> block)
@@ -92,8 +90,8 @@ void razors(display_frame_t frame,
         OGL_TRACE;
         double const phase = ms / 1000.0;
 
-        GLint transformLoc = glGetUniformLocation(shader.ref(), "transform");
-        GLint colorLoc = glGetUniformLocation(shader.ref(), "g_color");
+        GLint transformLoc = shader.uniformLocation("transform");
+        GLint colorLoc = shader.uniformLocation("g_color");
 
         float aa = amplitude;
 
@@ -139,6 +137,11 @@ void razors(display_frame_t frame,
                                 matrix4_identity(m);
                                 shaderSetMaterial(shader, colorLoc, mat);
                                 shaderSetTransform(shader, transformLoc, m);
+                                // sampling the target: each fragment reads back
+                                // only its own texel, which a barrier makes defined
+                                if (GLEW_ARB_texture_barrier) {
+                                        glTextureBarrier();
+                                }
                                 rdq (frame, shader, *feedbacks[0], 1.0f, 0);
                         }
 
@@ -153,14 +156,13 @@ void razors(display_frame_t frame,
 
                                 {
                                         WithMaterialOn material(blacken);
-                                        auto position_attrib = glGetAttribLocation(shader.ref(), "position");
-                                        auto texcoord_attrib = glGetAttribLocation(shader.ref(), "texcoord");
+                                        auto position_attrib = shader.attribLocation("position");
+                                        auto texcoord_attrib = shader.attribLocation("texcoord");
 
                                         quad.bind(position_attrib, texcoord_attrib);
 
-                                        glUseProgram(shader.ref());
+                                        useShaderProgram(shader.ref());
                                         quad.draw();
-                                        glUseProgram(0);
                                 }
                         }
                 });
@@ -197,14 +199,13 @@ void razors(display_frame_t frame,
                                 quad.defQuad2d(0, -1.0f, 1.0f, 2.0f, -2.0f,
                                                0.0f, 0.0f, uv[0], uv[1]);
 
-                                auto position_attrib = glGetAttribLocation(seedshader.ref(), "position");
-                                auto texcoord_attrib = glGetAttribLocation(seedshader.ref(), "texcoord");
+                                auto position_attrib = seedshader.attribLocation("position");
+                                auto texcoord_attrib = seedshader.attribLocation("texcoord");
                                 quad.bind(position_attrib, texcoord_attrib);
 
-                                glUseProgram(seedshader.ref());
+                                useShaderProgram(seedshader.ref());
 
                                 quad.draw();
-                                glUseProgram(0);
                         });
                 }
         }
@@ -18,9 +18,30 @@ public:
         static ShaderProgram create(std::string const& vertex_shader_code,
                                     std::string const& fragment_shader_code);
 
+        /**
+         * @returns true once the driver is done compiling and linking,
+         * without blocking when parallel shader compile is supported.
+         *
+         * errors are reported and locations introspected on completion.
+         */
+        bool poll();
+
         void validate() const;
         GLuint ref() const;
 
+        /// locations introspected at link time, -1 when inactive
+        GLint uniformLocation(std::string const& name) const;
+        GLint attribLocation(std::string const& name) const;
+
+        /**
+         * set a uniform of the program, without binding it when
+         * glProgramUniform is available.
+         *
+         * skipped when location is inactive, or already holds values.
+         */
+        void setUniform4fv(GLint location, GLfloat const values[4]) const;
+        void setUniformMatrix4fv(GLint location, GLfloat const values[16]) const;
+
         ShaderProgram();
         ~ShaderProgram();
         ShaderProgram(ShaderProgram&& other);
@@ -36,29 +57,32 @@ class ShaderLoader
 {
 public:
         ShaderLoader(DisplayThreadTasks& display_tasks, FileSystem& fs) :
+                displayTasks(display_tasks),
                 fileLoader(makeFileLoader(fs, display_tasks))
         {}
 
+        /// bind_shader is called on the display thread once linked
         void load_shader(std::string vs_path,
                          std::string fs_path,
                          std::function<void(ShaderProgram&&)> bind_shader);
 
 private:
+        DisplayThreadTasks& displayTasks;
         FileLoaderResource fileLoader;
 };
 
+/// glUseProgram, skipped when the program is already in use
+void useShaderProgram(GLuint program);
+
+/// the program stays in use after the scope, for the next user
 class WithShaderProgramScope
 {
 public:
         WithShaderProgramScope(ShaderProgram const& program)
         {
-                glUseProgram(program.ref());
+                useShaderProgram(program.ref());
         }
 
-        ~WithShaderProgramScope()
-        {
-                glUseProgram(0);
-        }
 private:
         WithShaderProgramScope(WithShaderProgramScope&) = delete;
         WithShaderProgramScope(WithShaderProgramScope&&) = delete;
@@ -1,17 +1,32 @@
 #include <GL/glew.h>
 
+#include <cstring>
 #include <sstream>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
 using std::vector;
 using std::string;
 using std::stringstream;
+using std::unordered_map;
 
 #include "shader_types.h"
 #include "main_types.h"
 
+static GLuint const UNKNOWN_PROGRAM = ~GLuint(0);
+static GLuint currentProgram = UNKNOWN_PROGRAM;
+
+void useShaderProgram(GLuint program)
+{
+        if (program == currentProgram) {
+                return;
+        }
+        currentProgram = program;
+        glUseProgram(program);
+}
+
 class Program
 {
 public:
@@ -35,6 +50,10 @@ public:
         ~Program()
         {
                 if (ref) {
+                        if (ref == currentProgram) {
+                                // stays in use until replaced
+                                currentProgram = UNKNOWN_PROGRAM;
+                        }
                         glDeleteProgram(ref);
                 }
                 ref = 0;
@@ -90,16 +109,30 @@ public:
         Impl(GLuint program_ref) : program(program_ref) {}
         Impl(ShaderProgram::Impl&& other) :
                 program(std::move(other.program)),
-                shaders(std::move(other.shaders)) {}
+                shaders(std::move(other.shaders)),
+                uniforms(std::move(other.uniforms)),
+                attribs(std::move(other.attribs)),
+                shadows(std::move(other.shadows)),
+                linked(other.linked) {}
         Impl& operator=(ShaderProgram::Impl&& other)
         {
                 shaders = std::move(other.shaders);
                 program = std::move(other.program);
+                uniforms = std::move(other.uniforms);
+                attribs = std::move(other.attribs);
+                shadows = std::move(other.shadows);
+                linked = other.linked;
                 return *this;
         }
 
         Program program;
         vector<Shader> shaders;
+        unordered_map<string, GLint> uniforms;
+        unordered_map<string, GLint> attribs;
+        /// values last set, per uniform location
+        unordered_map<GLint, vector<GLfloat>> shadows;
+        /// reflected, or failed, once the driver is done linking
+        bool linked = false;
 
         Impl(ShaderProgram::Impl const& other) = delete;
         Impl& operator= (ShaderProgram::Impl const& other) = delete;
@@ -124,6 +157,28 @@ public:
         vector<char const*> cstrs;
 };
 
+static bool hasParallelCompile()
+{
+        return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+static void setCompilerThreadsOnce()
+{
+        static bool done = false;
+        if (done) {
+                return;
+        }
+        done = true;
+
+        // as many compiler threads as the driver wants
+        auto const threads = ~GLuint(0);
+        if (GLEW_KHR_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsKHR(threads);
+        } else if (GLEW_ARB_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsARB(threads);
+        }
+}
+
 class ShaderProgramBuilder
 {
 private:
@@ -132,21 +187,6 @@ private:
                 Lines lines (source);
                 glShaderSource(shader.ref, lines.cstrs.size(), &lines.cstrs.front(), NULL);
                 glCompileShader(shader.ref);
-
-                GLint status;
-                glGetShaderiv (shader.ref, GL_COMPILE_STATUS, &status);
-                if (status == GL_FALSE) {
-                        GLint length;
-                        glGetShaderiv (shader.ref, GL_INFO_LOG_LENGTH, &length);
-
-                        vector<char> sinfo;
-                        sinfo.reserve(length + 1);
-                        glGetShaderInfoLog(shader.ref, length, &length, &sinfo.front());
-
-                        printf ("ERROR compiling shader [%s] with source [\n", &sinfo.front());
-                        printf ("%s", source.c_str());
-                        printf ("]\n");
-                }
         }
 
         void attach(GLint type, string const& source)
@@ -157,6 +197,11 @@ private:
                 content.shaders.push_back(std::move(shader));
         }
 public:
+        ShaderProgramBuilder()
+        {
+                setCompilerThreadsOnce();
+        }
+
         ShaderProgramBuilder& addVertexShaderCode(string const& source)
         {
                 attach(GL_VERTEX_SHADER, source);
@@ -167,6 +212,7 @@ public:
                 attach(GL_FRAGMENT_SHADER, source);
                 return *this;
         }
+        /// compile and link without waiting, see ShaderProgram::poll
         ShaderProgram::Impl&& link()
         {
                 glLinkProgram(content.program.ref);
@@ -176,6 +222,85 @@ public:
         ShaderProgram::Impl content;
 };
 
+class ShaderProgramReflector
+{
+public:
+        ShaderProgramReflector(ShaderProgram::Impl& content) : content(content) {}
+
+        bool isCompiled(Shader const& shader) const
+        {
+                GLint status;
+                glGetShaderiv (shader.ref, GL_COMPILE_STATUS, &status);
+                if (status == GL_FALSE) {
+                        GLint length;
+                        glGetShaderiv (shader.ref, GL_INFO_LOG_LENGTH, &length);
+
+                        vector<char> sinfo;
+                        sinfo.reserve(length + 1);
+                        glGetShaderInfoLog(shader.ref, length, &length, &sinfo.front());
+
+                        printf ("ERROR compiling shader [%s]\n", &sinfo.front());
+                        return false;
+                }
+                return true;
+        }
+
+        bool isLinked() const
+        {
+                auto const ref = content.program.ref;
+                GLint status;
+                glGetProgramiv (ref, GL_LINK_STATUS, &status);
+                if (status == GL_FALSE) {
+                        GLint length;
+                        glGetProgramiv (ref, GL_INFO_LOG_LENGTH, &length);
+
+                        vector<char> pinfo;
+                        pinfo.reserve(length + 1);
+                        glGetProgramInfoLog (ref, length, &length, &pinfo.front());
+
+                        printf ("ERROR linking program [%s]\n", &pinfo.front());
+                        return false;
+                }
+                return true;
+        }
+
+        template <typename GetActiveFn, typename GetLocationFn>
+        void reflectVariables(unordered_map<string, GLint>& locations,
+                              GLenum countParameter,
+                              GLenum maxLengthParameter,
+                              GetActiveFn getActive,
+                              GetLocationFn getLocation) const
+        {
+                auto const ref = content.program.ref;
+                GLint count = 0;
+                GLint maxLength = 0;
+                glGetProgramiv(ref, countParameter, &count);
+                glGetProgramiv(ref, maxLengthParameter, &maxLength);
+
+                vector<char> name (maxLength + 1);
+                for (GLint i = 0; i < count; i++) {
+                        GLsizei length = 0;
+                        GLint size;
+                        GLenum type;
+                        getActive(ref, i, name.size(), &length, &size, &type, &name.front());
+                        string const variableName (&name.front(), length);
+                        locations[variableName] = getLocation(ref, variableName.c_str());
+                }
+        }
+
+        void reflect()
+        {
+                reflectVariables(content.uniforms,
+                                 GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH,
+                                 glGetActiveUniform, glGetUniformLocation);
+                reflectVariables(content.attribs,
+                                 GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH,
+                                 glGetActiveAttrib, glGetAttribLocation);
+        }
+
+        ShaderProgram::Impl& content;
+};
+
 ShaderProgram ShaderProgram::create(std::string const& vertex_shader_code,
                                     std::string const& fragment_shader_code)
 {
@@ -188,6 +313,33 @@ ShaderProgram ShaderProgram::create(std::string const& vertex_shader_code,
         return shader_program;
 }
 
+bool ShaderProgram::poll()
+{
+        auto& content = *impl;
+        if (content.linked || !content.program.ref) {
+                return true;
+        }
+        if (hasParallelCompile()) {
+                // also GL_COMPLETION_STATUS_ARB
+                GLint completed = GL_FALSE;
+                glGetProgramiv(content.program.ref, GL_COMPLETION_STATUS_KHR, &completed);
+                if (completed == GL_FALSE) {
+                        return false;
+                }
+        }
+
+        content.linked = true;
+        auto reflector = ShaderProgramReflector(content);
+        auto compiled = true;
+        for (auto const& shader : content.shaders) {
+                compiled = reflector.isCompiled(shader) && compiled;
+        }
+        if (compiled && reflector.isLinked()) {
+                reflector.reflect();
+        }
+        return true;
+}
+
 void ShaderProgram::validate() const
 {
         glValidateProgram (impl->program.ref);
@@ -211,6 +363,74 @@ GLuint ShaderProgram::ref() const
         return impl->program.ref;
 }
 
+static GLint locationIn(unordered_map<string, GLint> const& locations,
+                        string const& name)
+{
+        auto entry = locations.find(name);
+        if (entry == locations.end()) {
+                return -1;
+        }
+        return entry->second;
+}
+
+GLint ShaderProgram::uniformLocation(std::string const& name) const
+{
+        return locationIn(impl->uniforms, name);
+}
+
+GLint ShaderProgram::attribLocation(std::string const& name) const
+{
+        return locationIn(impl->attribs, name);
+}
+
+/**
+ * record values as the last ones set at location.
+ *
+ * @returns false when they already were
+ */
+static bool updateShadow(unordered_map<GLint, vector<GLfloat>>& shadows,
+                         GLint location, GLfloat const* values, size_t count)
+{
+        auto& shadow = shadows[location];
+        if (shadow.size() == count
+            && std::memcmp(&shadow.front(), values, count * sizeof *values) == 0) {
+                return false;
+        }
+        shadow.assign(values, values + count);
+        return true;
+}
+
+static bool hasProgramUniform()
+{
+        return GLEW_ARB_separate_shader_objects || GLEW_VERSION_4_1;
+}
+
+void ShaderProgram::setUniform4fv(GLint location, GLfloat const values[4]) const
+{
+        if (location < 0 || !updateShadow(impl->shadows, location, values, 4)) {
+                return;
+        }
+        if (hasProgramUniform()) {
+                glProgramUniform4fv(impl->program.ref, location, 1, values);
+                return;
+        }
+        useShaderProgram(impl->program.ref);
+        glUniform4fv(location, 1, values);
+}
+
+void ShaderProgram::setUniformMatrix4fv(GLint location, GLfloat const values[16]) const
+{
+        if (location < 0 || !updateShadow(impl->shadows, location, values, 16)) {
+                return;
+        }
+        if (hasProgramUniform()) {
+                glProgramUniformMatrix4fv(impl->program.ref, location, 1, GL_FALSE, values);
+                return;
+        }
+        useShaderProgram(impl->program.ref);
+        glUniformMatrix4fv(location, 1, GL_FALSE, values);
+}
+
 ShaderProgram::ShaderProgram() : impl(new ShaderProgram::Impl(0)) {}
 ShaderProgram::~ShaderProgram() = default;
 ShaderProgram::ShaderProgram(ShaderProgram&& other) :
@@ -227,7 +447,15 @@ void ShaderLoader::load_shader(std::string vs_path,
 {
         loadFilePair(*fileLoader.get(), vs_path, fs_path,
         [=](std::string const& vs_content, std::string const& fs_content) {
-                auto shader = ShaderProgram::create(vs_content, fs_content);
-                bind_shader(std::move(shader));
+                // handed over once linked, polling on later frames
+                auto shader = std::make_shared<ShaderProgram>
+                              (ShaderProgram::create(vs_content, fs_content));
+                displayTasks.add_task([=]() {
+                        if (!shader->poll()) {
+                                return false;
+                        }
+                        bind_shader(std::move(*shader));
+                        return true;
+                });
         });
 }
@@ -1,6 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace estd
 {
@@ -10,4 +18,422 @@ std::unique_ptr<T> make_unique( Args&& ...args )
 {
         return std::unique_ptr<T>( new T( std::forward<Args>(args)... ) );
 }
+
+/**
+ * vector keeping up to N elements inline, only spilling to the heap
+ * beyond that. its capacity is kept when cleared or assigned to.
+ */
+template <typename T, size_t N>
+class small_vector
+{
+public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = T const*;
+
+        small_vector() = default;
+
+        small_vector(std::initializer_list<T> elements)
+        {
+                append(std::begin(elements), std::end(elements));
+        }
+
+        template <typename InputIt,
+                  typename = typename std::iterator_traits<InputIt>::iterator_category>
+        small_vector(InputIt first, InputIt last)
+        {
+                append(first, last);
+        }
+
+        small_vector(std::vector<T> const& elements)
+        {
+                append(std::begin(elements), std::end(elements));
+        }
+
+        small_vector(small_vector const& other)
+        {
+                append(other.begin(), other.end());
+        }
+
+        small_vector(small_vector&& other)
+        {
+                steal(other);
+        }
+
+        small_vector& operator=(small_vector const& other)
+        {
+                if (this != &other) {
+                        clear();
+                        append(other.begin(), other.end());
+                }
+                return *this;
+        }
+
+        small_vector& operator=(small_vector&& other)
+        {
+                if (this != &other) {
+                        clear();
+                        freeHeap();
+                        steal(other);
+                }
+                return *this;
+        }
+
+        ~small_vector()
+        {
+                clear();
+                freeHeap();
+        }
+
+        T* data()
+        {
+                return heap ? heap : reinterpret_cast<T*> (&inlineStorage);
+        }
+
+        T const* data() const
+        {
+                return heap ? heap : reinterpret_cast<T const*> (&inlineStorage);
+        }
+
+        iterator begin()
+        {
+                return data();
+        }
+
+        iterator end()
+        {
+                return data() + count;
+        }
+
+        const_iterator begin() const
+        {
+                return data();
+        }
+
+        const_iterator end() const
+        {
+                return data() + count;
+        }
+
+        size_t size() const
+        {
+                return count;
+        }
+
+        bool empty() const
+        {
+                return count == 0;
+        }
+
+        T& operator[](size_t index)
+        {
+                return data()[index];
+        }
+
+        T const& operator[](size_t index) const
+        {
+                return data()[index];
+        }
+
+        T& front()
+        {
+                return data()[0];
+        }
+
+        T const& front() const
+        {
+                return data()[0];
+        }
+
+        T& back()
+        {
+                return data()[count - 1];
+        }
+
+        T const& back() const
+        {
+                return data()[count - 1];
+        }
+
+        void reserve(size_t newCapacity)
+        {
+                if (newCapacity <= capacity) {
+                        return;
+                }
+                moveTo(allocate(newCapacity), newCapacity);
+        }
+
+        template <typename ...Args>
+        T& emplace_back(Args&& ...args)
+        {
+                if (count == capacity) {
+                        // args may refer to our elements: construct the
+                        // new one before moving them out
+                        auto const larger = allocate(2 * capacity);
+                        auto const element = new (larger + count) T(std::forward<Args>(args)...);
+                        moveTo(larger, 2 * capacity);
+                        count++;
+                        return *element;
+                }
+                auto const element = new (data() + count) T(std::forward<Args>(args)...);
+                count++;
+                return *element;
+        }
+
+        void push_back(T const& value)
+        {
+                emplace_back(value);
+        }
+
+        void push_back(T&& value)
+        {
+                emplace_back(std::move(value));
+        }
+
+        void pop_back()
+        {
+                count--;
+                data()[count].~T();
+        }
+
+        void resize(size_t newSize)
+        {
+                while (count > newSize) {
+                        pop_back();
+                }
+                reserve(newSize);
+                while (count < newSize) {
+                        emplace_back();
+                }
+        }
+
+        void clear()
+        {
+                while (count > 0) {
+                        pop_back();
+                }
+        }
+
+private:
+        static T* allocate(size_t elementCount)
+        {
+                return static_cast<T*> (::operator new(elementCount * sizeof(T)));
+        }
+
+        /// move the elements into larger, which becomes our storage
+        void moveTo(T* larger, size_t newCapacity)
+        {
+                auto const elements = data();
+                for (size_t i = 0; i < count; i++) {
+                        new (larger + i) T(std::move(elements[i]));
+                        elements[i].~T();
+                }
+                freeHeap();
+                heap = larger;
+                capacity = newCapacity;
+        }
+
+        template <typename InputIt>
+        void append(InputIt first, InputIt last)
+        {
+                for (; first != last; ++first) {
+                        emplace_back(*first);
+                }
+        }
+
+        void steal(small_vector& other)
+        {
+                if (other.heap) {
+                        heap = other.heap;
+                        capacity = other.capacity;
+                        count = other.count;
+                        other.heap = nullptr;
+                        other.capacity = N;
+                        other.count = 0;
+                        return;
+                }
+
+                for (auto& element : other) {
+                        emplace_back(std::move(element));
+                }
+                other.clear();
+        }
+
+        void freeHeap()
+        {
+                if (heap) {
+                        ::operator delete(heap);
+                        heap = nullptr;
+                        capacity = N;
+                }
+        }
+
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type inlineStorage[N];
+        T* heap = nullptr;
+        size_t count = 0;
+        size_t capacity = N;
+};
+
+template <typename T, size_t N, size_t M>
+bool operator==(small_vector<T, N> const& a, small_vector<T, M> const& b)
+{
+        return a.size() == b.size()
+               && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename T, size_t N, size_t M>
+bool operator!=(small_vector<T, N> const& a, small_vector<T, M> const& b)
+{
+        return !(a == b);
+}
+
+/// non owning view of contiguous elements, like C++20's std::span
+template <typename T>
+class span
+{
+public:
+        using value_type = typename std::remove_const<T>::type;
+        using iterator = T*;
+
+        span() = default;
+
+        span(T* elements, size_t count) : elements(elements), count(count) {}
+
+        template <size_t N>
+        span(T (&elements)[N]) : elements(elements), count(N) {}
+
+        template <typename Container,
+                  typename = decltype(std::declval<Container&>().data())>
+        span(Container& container) :
+                elements(container.data()), count(container.size())
+        {}
+
+        iterator begin() const
+        {
+                return elements;
+        }
+
+        iterator end() const
+        {
+                return elements + count;
+        }
+
+        size_t size() const
+        {
+                return count;
+        }
+
+        bool empty() const
+        {
+                return count == 0;
+        }
+
+        T& operator[](size_t index) const
+        {
+                return elements[index];
+        }
+
+private:
+        T* elements = nullptr;
+        size_t count = 0;
+};
+
+template <typename Signature, size_t Capacity>
+class inplace_function;
+
+/**
+ * callable kept inline in Capacity bytes: unlike std::function, it
+ * never allocates. callables too large for it do not compile.
+ */
+template <typename R, typename ...Args, size_t Capacity>
+class inplace_function<R(Args...), Capacity>
+{
+public:
+        inplace_function() = default;
+
+        template <typename F,
+                  typename Callable = typename std::decay<F>::type,
+                  typename = typename std::enable_if<
+                          !std::is_same<Callable, inplace_function>::value>::type>
+        inplace_function(F&& f)
+        {
+                static_assert(sizeof(Callable) <= Capacity,
+                              "callable larger than the inline storage");
+                static_assert(alignof(Callable) <= alignof(Storage),
+                              "callable more aligned than the inline storage");
+
+                new (&storage) Callable(std::forward<F>(f));
+                invoke = [](void* callable, Args... args) -> R {
+                        return (*static_cast<Callable*> (callable))(std::forward<Args>(args)...);
+                };
+                relocate = [](void* destination, void* source) {
+                        auto& callable = *static_cast<Callable*> (source);
+                        if (destination) {
+                                new (destination) Callable(std::move(callable));
+                        }
+                        callable.~Callable();
+                };
+        }
+
+        inplace_function(inplace_function&& other)
+        {
+                steal(other);
+        }
+
+        inplace_function& operator=(inplace_function&& other)
+        {
+                if (this != &other) {
+                        reset();
+                        steal(other);
+                }
+                return *this;
+        }
+
+        ~inplace_function()
+        {
+                reset();
+        }
+
+        R operator()(Args... args) const
+        {
+                return invoke(&storage, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const
+        {
+                return invoke != nullptr;
+        }
+
+private:
+        inplace_function(inplace_function const&) = delete;
+        inplace_function& operator=(inplace_function const&) = delete;
+
+        using Storage = typename std::aligned_storage<Capacity>::type;
+
+        void steal(inplace_function& other)
+        {
+                if (!other.invoke) {
+                        return;
+                }
+                other.relocate(&storage, &other.storage);
+                invoke = other.invoke;
+                relocate = other.relocate;
+                other.invoke = nullptr;
+                other.relocate = nullptr;
+        }
+
+        void reset()
+        {
+                if (invoke) {
+                        relocate(nullptr, &storage);
+                        invoke = nullptr;
+                        relocate = nullptr;
+                }
+        }
+
+        mutable Storage storage;
+        R (*invoke)(void* callable, Args... args) = nullptr;
+        /// moves the callable to destination unless null, then destroys it
+        void (*relocate)(void* destination, void* source) = nullptr;
+};
 }
@@ -3,9 +3,15 @@
 // implementations
 
 #include "../gl3companion/glframebuffers.cpp"
+#include "../gl3companion/glprogrambinaries.cpp"
 #include "../gl3companion/glresources.cpp"
 #include "../gl3companion/glshaders.cpp"
+#include "../gl3companion/glstate.cpp"
+#include "../gl3companion/glstream.cpp"
 #include "../gl3companion/gltexturing.cpp"
+#include "../gl3texture/framegraph.cpp"
+#include "../gl3texture/framepipeline.cpp"
+#include "../gl3texture/objectlists.cpp"
 #include "../gl3texture/renderer.cpp"
 
 size_t define2dQuadIndices(BufferResource const& buffer)
@@ -19,7 +25,7 @@ size_t define2dQuadIndices(BufferResource const& buffer)
                 count = sizeof data / sizeof data[0];
 
                 glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof data, data,
-                             GL_STREAM_DRAW);
+                             GL_STATIC_DRAW);
         });
 
         return count;
@@ -37,7 +43,7 @@ GLvoid* define2dQuadBuffer(BufferResource const& buffer, float xmin,
                         xmin + width, ymin,
                 };
 
-                glBufferData(GL_ARRAY_BUFFER, sizeof data, data, GL_STREAM_DRAW);
+                glBufferData(GL_ARRAY_BUFFER, sizeof data, data, GL_STATIC_DRAW);
         });
 
         return 0;
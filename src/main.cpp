@@ -1,6 +1,8 @@
 #include "razors.hpp"
 #include "razorsV2.hpp"
 
+#include "../gl3companion/glstate.hpp"
+
 #include <GL/glew.h>
 #include <micros/api.h>
 
@@ -30,6 +32,9 @@ static void draw_changing_background(uint64_t time_micros)
 
 extern void render_next_gl3(uint64_t time_micros)
 {
+        // the runtime may change the GL state between frames
+        glstate::invalidate();
+
         draw_changing_background(time_micros);
 
         static struct Resources {
@@ -5,6 +5,8 @@
 #include "../gl3companion/glinlines.hpp"
 #include "../gl3companion/glresource_types.hpp"
 #include "../gl3companion/glshaders.hpp"
+#include "../gl3companion/glstate.hpp"
+#include "../gl3companion/glstream.hpp"
 #include "../gl3companion/gltexturing.hpp"
 #include "compiler.hpp"
 #include "estd.hpp"
@@ -25,9 +27,9 @@ struct Texture : public TextureResource {
 
 static void withTexture(Texture const& texture, std::function<void()> fn)
 {
-        glBindTexture(texture.target, texture.id);
+        glstate::activeTexture(GL_TEXTURE0);
+        glstate::bindTexture(texture.target, texture.id);
         fn();
-        glBindTexture(texture.target, 0);
 }
 
 struct Framebuffer {
@@ -51,13 +53,20 @@ struct Framebuffer {
         int height;
 };
 
+/// streamed anew every time it is defined, valid until the next frames
 struct Geometry {
-        size_t indicesCount;
-        BufferResource indices;
-        BufferResource vertices;
-        BufferResource texcoords;
+        size_t indicesCount = 0;
+        size_t indicesOffset = 0;
+        size_t verticesOffset = 0;
+        size_t texcoordsOffset = 0;
 };
 
+static StreamBuffer& geometryStream()
+{
+        static StreamBuffer stream;
+        return stream;
+}
+
 // as a sequence of triangles
 static void define2dQuadTriangles(Geometry& geometry,
                                   float x, float y,
@@ -65,42 +74,29 @@ static void define2dQuadTriangles(Geometry& geometry,
                                   float umin, float vmin,
                                   float umax, float vmax)
 {
+        auto& stream = geometryStream();
+
         GLuint indices[] = {
                 0, 1, 2, 2, 3, 0,
         };
-
         geometry.indicesCount = sizeof indices / sizeof indices[0];
+        geometry.indicesOffset = stream.write(indices, sizeof indices);
 
-        withElementBuffer(geometry.indices,
-        [&indices]() {
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof indices, indices,
-                             GL_STREAM_DRAW);
-        });
-
-        withArrayBuffer(geometry.vertices,
-        [=]() {
-                float vertices[] = {
-                        x, y,
-                        x, y + height,
-                        x + width, y + height,
-                        x + width, y,
-                };
-
-                glBufferData(GL_ARRAY_BUFFER, sizeof vertices, vertices, GL_STREAM_DRAW);
-        });
-
-        withArrayBuffer(geometry.texcoords,
-        [=]() {
-                float texcoords[] = {
-                        umin, vmin,
-                        umin, vmax,
-                        umax, vmax,
-                        umax, vmin,
-                };
-
-                glBufferData(GL_ARRAY_BUFFER, sizeof texcoords, texcoords, GL_STREAM_DRAW);
+        float vertices[] = {
+                x, y,
+                x, y + height,
+                x + width, y + height,
+                x + width, y,
+        };
+        geometry.verticesOffset = stream.write(vertices, sizeof vertices);
 
-        });
+        float texcoords[] = {
+                umin, vmin,
+                umin, vmax,
+                umax, vmax,
+                umax, vmin,
+        };
+        geometry.texcoordsOffset = stream.write(texcoords, sizeof texcoords);
 }
 
 class Razors
@@ -117,78 +113,112 @@ public:
 
 struct RenderingProgram {
         GLuint programId;
-        GLsizei elementCount;
+        GLint resolutionLoc;
+        GLint positionAttrib;
+        GLint texcoordAttrib;
         VertexArrayResource array;
 };
 
 static void defineRenderingProgram(RenderingProgram& renderingProgram,
-                                   ShaderProgramResource const& program, Geometry const& geometry)
+                                   ShaderProgramResource const& program)
 {
         auto const programId = program.id;
         renderingProgram.programId = programId;
-        renderingProgram.elementCount = geometry.indicesCount;
+        renderingProgram.resolutionLoc = glGetUniformLocation(programId, "iResolution");
+        renderingProgram.positionAttrib = glGetAttribLocation(programId, "position");
+        renderingProgram.texcoordAttrib = glGetAttribLocation(programId, "texcoord");
 
         withVertexArray(renderingProgram.array,
-        [&program,&geometry,programId]() {
-                GLuint const position_attrib = glGetAttribLocation(program.id, "position");
-                GLuint const texcoord_attrib = glGetAttribLocation(program.id, "texcoord");
-
-                glBindBuffer(GL_ARRAY_BUFFER, geometry.texcoords.id);
-                glVertexAttribPointer(texcoord_attrib, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-                glBindBuffer(GL_ARRAY_BUFFER, geometry.vertices.id);
-                glVertexAttribPointer(position_attrib, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.indices.id);
-
-                glEnableVertexAttribArray(position_attrib);
-                glEnableVertexAttribArray(texcoord_attrib);
+        [&program,&renderingProgram]() {
+                glEnableVertexAttribArray(renderingProgram.positionAttrib);
+                glEnableVertexAttribArray(renderingProgram.texcoordAttrib);
 
                 validate(program);
         });
 }
 
 static void drawTriangles(RenderingProgram const& primitive,
+                          Geometry const& geometry,
                           Texture const& texture)
 {
         withTexture(texture,
-        [&primitive]() {
+        [&primitive,&geometry]() {
                 auto const program = primitive.programId;
-                glUseProgram(program);
+                glstate::useProgram(program);
 
-                auto const resolutionLoc = glGetUniformLocation(program, "iResolution");
-                if (resolutionLoc) {
+                auto const resolutionLoc = primitive.resolutionLoc;
+                if (resolutionLoc >= 0) {
                         GLint wh[4];
                         glGetIntegerv(GL_VIEWPORT, wh);
                         glUniform3f(resolutionLoc,
                                     glfloat(wh[2]), glfloat(wh[3]), 0.0f);
                 }
 
-                withVertexArray(primitive.array, [&primitive]() {
-                        glDrawElements(GL_TRIANGLES, primitive.elementCount, GL_UNSIGNED_INT, 0);
+                withVertexArray(primitive.array, [&primitive,&geometry]() {
+                        auto const offset = [](size_t bytes) {
+                                return reinterpret_cast<GLvoid*> (bytes);
+                        };
+
+                        // the geometry moves within the stream every time it is defined
+                        auto const stream = geometryStream().buffer();
+                        glstate::bindBuffer(GL_ARRAY_BUFFER, stream);
+                        glVertexAttribPointer(primitive.texcoordAttrib, 2, GL_FLOAT, GL_FALSE, 0,
+                                              offset(geometry.texcoordsOffset));
+                        glVertexAttribPointer(primitive.positionAttrib, 2, GL_FLOAT, GL_FALSE, 0,
+                                              offset(geometry.verticesOffset));
+                        glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream);
+
+                        glDrawElements(GL_TRIANGLES, geometry.indicesCount, GL_UNSIGNED_INT,
+                                       offset(geometry.indicesOffset));
                 });
-                glUseProgram(0);
         });
 }
 
 struct SimpleShaderProgram : public ShaderProgramResource {
         VertexShaderResource vertexShader;
         FragmentShaderResource fragmentShader;
+
+        // uniform locations, -1 when unused by the program
+        GLint colorLoc = -1;
+        GLint transformLoc = -1;
+        GLint depthLoc = -1;
+
+        LinkStatus status = LINK_PENDING;
 };
 
+/// starts compiling the program, see isLinked
 static void defineProgram(SimpleShaderProgram& program,
                           std::string const& vertexShaderSource,
                           std::string const& fragmentShaderSource)
 {
-        compile(program.vertexShader, vertexShaderSource);
-        compile(program.fragmentShader, fragmentShaderSource);
-        link(program, program.vertexShader, program.fragmentShader);
+        submitCompile(program.vertexShader, vertexShaderSource);
+        submitCompile(program.fragmentShader, fragmentShaderSource);
+        submitLink(program, program.vertexShader, program.fragmentShader);
+}
+
+/**
+ * completes the program and its quad once the driver is done linking
+ * it, without waiting for it.
+ */
+static bool isLinked(SimpleShaderProgram& program, RenderingProgram& texturedQuad)
+{
+        if (program.status != LINK_PENDING) {
+                return program.status == LINK_SUCCEEDED;
+        }
+        program.status = pollLink(program, program.vertexShader, program.fragmentShader);
+        if (program.status != LINK_SUCCEEDED) {
+                return false;
+        }
+
+        program.colorLoc = glGetUniformLocation(program.id, "g_color");
+        program.transformLoc = glGetUniformLocation(program.id, "transform");
+        program.depthLoc = glGetUniformLocation(program.id, "depth");
 
         withShaderProgram(program,
         [&program]() {
                 GLint textureLoc = glGetUniformLocation(program.id, "tex");
-                GLint colorLoc = glGetUniformLocation(program.id, "g_color");
-                GLint transformLoc = glGetUniformLocation(program.id, "transform");
+                GLint colorLoc = program.colorLoc;
+                GLint transformLoc = program.transformLoc;
 
                 float idmatrix[4*4] = {
                         1.0f, 0.0f, 0.0f, 0.0f,
@@ -201,22 +231,25 @@ static void defineProgram(SimpleShaderProgram& program,
 
                 glUniform1i(textureLoc, 0); // bind to texture unit 0
         });
+
+        defineRenderingProgram(texturedQuad, program);
+        return true;
 }
 
 #include "inlineshaders.hpp"
 
 static void withPremultipliedAlphaBlending(std::function<void()> fn)
 {
-        glEnable(GL_BLEND);
-        glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-        glDisable (GL_DEPTH_TEST);
-        glDepthMask (GL_FALSE);
+        glstate::setCapability(GL_BLEND, true);
+        glstate::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glstate::setCapability(GL_DEPTH_TEST, false);
+        glstate::setDepthMask(false);
 
         fn();
 
-        glDepthMask (GL_TRUE);
-        glEnable (GL_DEPTH_TEST);
-        glDisable(GL_BLEND);
+        glstate::setDepthMask(true);
+        glstate::setCapability(GL_DEPTH_TEST, true);
+        glstate::setCapability(GL_BLEND, false);
 }
 
 static int nextPowerOfTwo(int number)
@@ -242,31 +275,22 @@ static void seed(float maxAlpha=0.06f)
                                  seed_texture);
                         });
 
-                        define2dQuadTriangles(quadTris, -1.0, -1.0, 2.0, 2.0, 0.0, 0.0, 1.0, 1.0);
                         defineProgram(program, seedVS, seedFS);
-
-                        auto depthLoc = glGetUniformLocation(program.id, "depth");
-                        withShaderProgram(program, [=]() {
-                                glUniform1f(depthLoc, 0.0f);
-                        });
-
-                        defineRenderingProgram(texturedQuad, program, quadTris);
                 };
 
                 Texture texture;
-                Geometry quadTris;
                 SimpleShaderProgram program;
                 RenderingProgram texturedQuad;
         } all;
 
-        if (all.program.id > 0) {
+        if (isLinked(all.program, all.texturedQuad)) {
                 static int i = 0;
 
                 withPremultipliedAlphaBlending
                 ([&] () {
                         auto& program = all.program;
-                        auto colorLoc = glGetUniformLocation(program.id, "g_color");
-                        auto depthLoc = glGetUniformLocation(program.id, "depth");
+                        auto colorLoc = program.colorLoc;
+                        auto depthLoc = program.depthLoc;
 
                         auto period = 121.0;
                         auto phase = (1.0 + cos(TAU * (float) i / period)) / 2.0;
@@ -281,7 +305,9 @@ static void seed(float maxAlpha=0.06f)
                                 glUniform1f(depthLoc, phase);
 
                         });
-                        drawTriangles(all.texturedQuad, all.texture);
+                        auto quadTris = Geometry {};
+                        define2dQuadTriangles(quadTris, -1.0, -1.0, 2.0, 2.0, 0.0, 0.0, 1.0, 1.0);
+                        drawTriangles(all.texturedQuad, quadTris, all.texture);
                 });
 
                 i++;
@@ -297,17 +323,17 @@ static void withOutputTo(Framebuffer const& framebuffer,
                          std::function<void()> draw)
 {
         auto resolution = viewport();
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.output.id);
+        glstate::bindFramebuffer(framebuffer.output.id);
         glDrawBuffer (GL_COLOR_ATTACHMENT0);
         glReadBuffer (GL_COLOR_ATTACHMENT0);
-        glViewport (0, 0, framebuffer.width, framebuffer.height);
+        glstate::setViewport (0, 0, framebuffer.width, framebuffer.height);
 
         draw();
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glstate::bindFramebuffer(0);
         glReadBuffer (GL_BACK);
         glDrawBuffer (GL_BACK);
-        glViewport(0, 0, resolution.first, resolution.second);
+        glstate::setViewport(0, 0, resolution.first, resolution.second);
 }
 
 static void projectFramebuffer(Framebuffer const& source,
@@ -316,27 +342,23 @@ static void projectFramebuffer(Framebuffer const& source,
         static struct Projector {
                 Projector ()
                 {
-                        define2dQuadTriangles(quadGeometry,  -1.0, -1.0, 2.0, 2.0, 0.0, 0.0, 1.0,
-                                              1.0);
                         defineProgram(program, defaultVS, projectorFS);
-
-                        defineRenderingProgram(texturedQuad, program, quadGeometry);
                 }
 
-                Geometry quadGeometry;
                 SimpleShaderProgram program;
                 RenderingProgram texturedQuad;
         } all;
 
-        if (all.program.id > 0) {
+        if (isLinked(all.program, all.texturedQuad)) {
                 // respect source projector's aspect ratio
                 float const yfactor = glfloat(source.height) / glfloat(source.width);
-                define2dQuadTriangles(all.quadGeometry,
+                auto quadGeometry = Geometry {};
+                define2dQuadTriangles(quadGeometry,
                                       -1.0f, -yfactor, 2.0f, 2.0f * yfactor,
                                       0.0f, 0.0f, 1.0f, 1.0f);
 
-                GLint colorLoc = glGetUniformLocation(all.program.id, "g_color");
-                GLint transformLoc = glGetUniformLocation(all.program.id, "transform");
+                GLint colorLoc = all.program.colorLoc;
+                GLint transformLoc = all.program.transformLoc;
 
                 // scale to screen
                 auto resolution = viewport();
@@ -355,7 +377,7 @@ static void projectFramebuffer(Framebuffer const& source,
                         auto const alpha = 0.9998f;
                         glUniform4f(colorLoc, alpha*1.0f, alpha*1.0f, alpha*1.0f, alpha);
                 });
-                drawTriangles(all.texturedQuad, source.result);
+                drawTriangles(all.texturedQuad, quadGeometry, source.result);
         }
 }
 
@@ -6,6 +6,7 @@
 
 #include "../gl3companion/glresource_types.hpp"
 #include "../gl3companion/glinlines.hpp"
+#include "../gl3texture/framegraph.hpp"
 #include "../gl3texture/quad.hpp"
 #include "../gl3texture/renderer.hpp"
 #include "../ref/matrix.hpp"
@@ -15,6 +16,15 @@
 static const double TAU =
         6.28318530717958647692528676655900576839433879875021;
 
+// inputs of the projector and seed programs
+static constexpr auto POSITION = VertexAttrib<2> { "position" };
+static constexpr auto TEXCOORD = VertexAttrib<2> { "texcoord" };
+static constexpr auto TEX = TextureUniform { "tex" };
+static constexpr auto G_COLOR = VecUniform<4> { "g_color" };
+static constexpr auto TRANSFORM = MatUniform<4> { "transform" };
+static constexpr auto I_RESOLUTION = VecUniform<3> { "iResolution" };
+static constexpr auto DEPTH = VecUniform<1> { "depth" };
+
 class RazorsV2
 {};
 
@@ -59,20 +69,20 @@ void draw(RazorsV2& self, double ms)
 {
         auto resolution = viewport();
 
-        auto transparentWhite = [](float alpha) -> std::vector<float> {
+        auto transparentWhite = [](float alpha) -> ProgramInputs::FloatValues {
                 return { alpha*1.0f, alpha*1.0f, alpha*1.0f, alpha };
         };
 
 #if 0
-        auto grey = [](float value) -> std::vector<float> {
+        auto grey = [](float value) -> ProgramInputs::FloatValues {
                 // of course this is not real grey, need to go through
                 // the standard gamma + color correction instead
                 return { value, value, value, 1.0f };
         };
 #endif
 
-        auto scaleTransform = [](float scale) -> std::vector<float> {
-                return std::vector<float> {
+        auto scaleTransform = [](float scale) -> ProgramInputs::FloatValues {
+                return ProgramInputs::FloatValues {
                         scale, 0.01f, 0.0f, 0.0f,
                         -0.01f, scale, 0.0f, 0.0f,
                         0.0f, 0.0f, scale, 0.0f,
@@ -101,7 +111,7 @@ void draw(RazorsV2& self, double ms)
                 return quad(Rect { -1.f, -1.f, 2.0f, 2.0f }, Rect {0.f, 0.f, 1.f, 1.f });
         };
 
-        auto identityMatrix = []() -> std::vector<float> {
+        auto identityMatrix = []() -> ProgramInputs::FloatValues {
                 return {
                         1.0f, 0.0f, 0.0f, 0.0f,
                         0.0f, 1.0f, 0.0f, 0.0f,
@@ -110,74 +120,114 @@ void draw(RazorsV2& self, double ms)
                 };
         };
 
-        auto projector = [=](TextureDef const& texture,
+        auto rQuad = [quad](float const cut) {
+                auto border = clamp_f(1.0f - cut, 0.0f, 1.0f);
+                auto hborder = border / 2.0f;
+                return quad( {
+                        -1.0f + border,
+                        -1.0f + border,
+                        2.0f - 2.0f*border,
+                        2.0f - 2.0f*border
+                },
+                { hborder, hborder, 1.0f - 2.0f*hborder, 1.0f - 2.0f*hborder });
+        };
+
+        static auto output = []() {
+                auto output = makeFrameSeries();
+                // relative to the working directory
+                setProgramBinaryDirectory(*output, "program-binaries");
+                return output;
+        }();
+
+        beginFrame(*output);
+
+        // retained resources: defined once, then referred to by
+        // handle. They are used every frame and thus never go stale.
+        static struct Resources {
+                Resources(FrameSeries& output,
+                          GeometryDef const& fullscreenQuadDef,
+                          GeometryDef const& innerQuadDef,
+                          GeometryDef const& outerQuadDef)
+                {
+                        seedProgram = defineProgram(output, intern(ProgramDef {
+                                .vertexShader = { .source = seedVS },
+                                .fragmentShader = { .source = seedFS },
+                        }));
+                        projectorProgram = defineProgram(output, intern(ProgramDef {
+                                .vertexShader = { .source = defaultVS },
+                                .fragmentShader = { .source = projectorFS },
+                        }));
+                        seedTexture = defineTexture(output, TextureDef {
+                                {},
+                                256,
+                                256,
+                                12,
+                                (TextureDefFn) seed_texture,
+                        });
+                        previousFrame = defineTarget(output, TextureDef {
+                                .width = 512,
+                                .height = 512,
+                        });
+                        resultFrame = defineTarget(output, TextureDef {
+                                .width = 1024,
+                                .height = 1024,
+                        });
+                        fullscreenQuad = defineMesh(output, fullscreenQuadDef);
+                        innerQuad = defineMesh(output, innerQuadDef);
+                        outerQuad = defineMesh(output, outerQuadDef);
+                }
+
+                ProgramHandle seedProgram;
+                ProgramHandle projectorProgram;
+                TextureHandle seedTexture;
+                TargetHandle previousFrame;
+                TargetHandle resultFrame;
+                MeshHandle fullscreenQuad;
+                MeshHandle innerQuad;
+                MeshHandle outerQuad;
+        } all { *output, fullscreenQuad(), rQuad(0.980f), rQuad(1.0f) };
+
+        auto projector = [&](TextureHandle texture,
         float scale, std::pair<GLint, GLint> viewport) -> RenderObjectDef {
                 return RenderObjectDef {
                         .inputs = ProgramInputs {
                                 {
-                                        { "position", 2 },
-                                        { "texcoord", 2 },
+                                        POSITION(),
+                                        TEXCOORD(),
                                 },
                                 {
-                                        {
-                                                "tex", texture
-                                        }
+                                        TEX(texture)
                                 },
                                 {
-                                        ProgramInputs::FloatInput { .name = "g_color", .values = transparentWhite(0.9998f)},
-                                        ProgramInputs::FloatInput { .name = "transform", .values = scaleTransform(scale), .last_row = 3 },
-                                        ProgramInputs::FloatInput { .name = "iResolution", .values = { (float) viewport.first, (float) viewport.second, 0.0 } },
+                                        constant(G_COLOR(transparentWhite(0.9998f))),
+                                        TRANSFORM(scaleTransform(scale)),
+                                        I_RESOLUTION({ (float) viewport.first, (float) viewport.second, 0.0 }),
                                 },
                                 {},
 
                         },
-                        .geometry = fullscreenQuad()
+                        .geometry = {},
+                        .mesh = all.fullscreenQuad
                 };
         };
 
         auto seed = RenderObjectDef {
                 .inputs = ProgramInputs {
                         {
-                                { "position", 2 }, { "texcoord", 2 }
+                                POSITION(), TEXCOORD()
                         },
                         {
-                                {
-                                        .name = "tex", TextureDef {
-                                                {},
-                                                256,
-                                                256,
-                                                12,
-                                                (TextureDefFn) seed_texture,
-                                        }
-                                },
+                                TEX(all.seedTexture),
                         },
                         {
-                                { .name = "depth", .values = { (float)(0.5 * (1.0 + sin(TAU * ms / 3000.0))) } } ,
-                                { .name = "transform", .values = identityMatrix(), .last_row = 3 },
-                                { .name = "g_color", .values = transparentWhite(0.06f) },
+                                DEPTH({ (float)(0.5 * (1.0 + sin(TAU * ms / 3000.0))) }),
+                                constant(TRANSFORM(identityMatrix())),
+                                G_COLOR(transparentWhite(0.06f)),
                         },
                         {},
                 },
-                .geometry = fullscreenQuad(),
-        };
-
-
-        auto vertexShader = [](std::string content) -> VertexShaderDef {
-                return VertexShaderDef { .source = content };
-        };
-
-        auto fragmentShader = [](std::string content) -> FragmentShaderDef {
-                return FragmentShaderDef { .source = content };
-        };
-
-        static auto output = makeFrameSeries();
-        static auto previousFrame = TextureDef {
-                .width = 512,
-                .height = 512,
-        };
-        static auto resultFrame = TextureDef {
-                .width = 1024,
-                .height = 1024,
+                .geometry = {},
+                .mesh = all.fullscreenQuad,
         };
 
         auto const clearFragments = FragmentOperationsDef {
@@ -192,99 +242,96 @@ void draw(RazorsV2& self, double ms)
         };
 #endif
 
-        auto const seedProgram = ProgramDef {
-                .vertexShader = vertexShader(seedVS),
-                .fragmentShader = fragmentShader(seedFS),
-        };
-
-        auto const projectorProgram = ProgramDef {
-                .vertexShader = vertexShader(defaultVS),
-                .fragmentShader = fragmentShader(projectorFS),
-        };
+        static auto graph = FrameGraph {};
 
-        beginFrame(*output);
+        auto const previousFrame = importTarget(graph, all.previousFrame);
+        auto const resultFrame = importTarget(graph, all.resultFrame);
+        auto const screen = importTarget(graph, {});
 
-        previousFrame = drawManyIntoTexture
-                        (*output, previousFrame, blendFragments,
-        projectorProgram, {
-                projector(resultFrame, 0.990f + 0.010f * sin(TAU * ms / 5000.0), resolution),
+        addPass(graph, { resultFrame }, previousFrame, blendFragments,
+        [&](FrameSeries& output, TargetHandle target) {
+                RenderObjectDef const objects[] = {
+                        projector(graphTexture(output, graph, resultFrame),
+                                  0.990f + 0.010f * sin(TAU * ms / 5000.0), resolution),
+                };
+                drawManyInto(output, target, blendFragments, all.projectorProgram, objects);
         });
-        previousFrame = drawManyIntoTexture
-        (*output, previousFrame, blendFragments, seedProgram, {
-                seed,
+        addPass(graph, {}, previousFrame, blendFragments,
+        [&](FrameSeries& output, TargetHandle target) {
+                RenderObjectDef const objects[] = {
+                        seed,
+                };
+                drawManyInto(output, target, blendFragments, all.seedProgram, objects);
         });
 
-        resultFrame = drawManyIntoTexture
-                      (*output, resultFrame, clearFragments, projectorProgram,
-        { projector(previousFrame, 1.004f, resolution) });
+        addPass(graph, { previousFrame }, resultFrame, clearFragments,
+        [&](FrameSeries& output, TargetHandle target) {
+                RenderObjectDef const objects[] = {
+                        projector(graphTexture(output, graph, previousFrame), 1.004f, resolution),
+                };
+                drawManyInto(output, target, clearFragments, all.projectorProgram, objects);
+        });
 
-        auto object = [resolution](TextureDef const& texture, matrix4 transform,
-        vector4 color, GeometryDef const& geometry) {
+        auto object = [resolution](TextureHandle texture, matrix4 transform,
+        vector4 color, MeshHandle mesh) {
                 return RenderObjectDef {
                         .inputs = ProgramInputs {
                                 {
-                                        { "position", 2 },
-                                        { "texcoord", 2 },
+                                        POSITION(),
+                                        TEXCOORD(),
                                 },
                                 {
-                                        {
-                                                "tex", texture
-                                        }
+                                        TEX(texture)
                                 },
                                 {
-                                        ProgramInputs::FloatInput { .name = "g_color", .values = { color, color + 4 } },
-                                        ProgramInputs::FloatInput { .name = "transform", .values = { transform, transform + 16 }, .last_row = 3 },
-                                        ProgramInputs::FloatInput { .name = "iResolution", .values = { (float) resolution.first, (float) resolution.second, 0.0 } },
+                                        G_COLOR({ color, color + 4 }),
+                                        TRANSFORM({ transform, transform + 16 }),
+                                        I_RESOLUTION({ (float) resolution.first, (float) resolution.second, 0.0 }),
                                 },
                                 {},
 
                         },
-                        .geometry = geometry
+                        .geometry = {},
+                        .mesh = mesh
                 };
         };
 
-        auto rQuad = [quad](float const cut) {
-                auto border = clamp_f(1.0f - cut, 0.0f, 1.0f);
-                auto hborder = border / 2.0f;
-                return quad( {
-                        -1.0f + border,
-                        -1.0f + border,
-                        2.0f - 2.0f*border,
-                        2.0f - 2.0f*border
-                },
-                { hborder, hborder, 1.0f - 2.0f*hborder, 1.0f - 2.0f*hborder });
-        };
-
-        {
-                auto phase = ms / 1000.0;
-                auto aa = 0.10;
-
-                vector4 color;
-                vector4_copy(color, &transparentWhite(0.98f).front());
+        auto phase = ms / 1000.0;
+        auto aa = 0.10;
+
+        vector4 color;
+        vector4_copy(color, &transparentWhite(0.98f).front());
+
+        matrix4 innerTransform;
+        matrix4_identity(innerTransform);
+        movev(innerTransform, 0.001*cos(phase/50.0));
+        scale1(innerTransform, 1.
+               + 0.001*sin(phase*TAU + TAU/6.0)
+               + 0.01*aa);
+        rotx(innerTransform, 1.0 / 96.0 * (1. + 0.1*sin(phase/7.0 * TAU/3.)));
+        rotz(innerTransform, 1.0 / 4.0 * sin(phase * TAU / 33.33));
+
+        addPass(graph, { resultFrame }, previousFrame, clearFragments,
+        [&](FrameSeries& output, TargetHandle target) {
+                RenderObjectDef const objects[] = {
+                        object(graphTexture(output, graph, resultFrame),
+                               innerTransform, color, all.innerQuad),
+                };
+                drawManyInto(output, target, clearFragments, all.projectorProgram, objects);
+        });
 
-                {
-                        matrix4 m;
-                        matrix4_identity(m);
-                        movev(m, 0.001*cos(phase/50.0));
-                        scale1(m, 1.
-                               + 0.001*sin(phase*TAU + TAU/6.0)
-                               + 0.01*aa);
-                        rotx(m, 1.0 / 96.0 * (1. + 0.1*sin(phase/7.0 * TAU/3.)));
-                        rotz(m, 1.0 / 4.0 * sin(phase * TAU / 33.33));
-
-                        previousFrame = drawManyIntoTexture
-                                        (*output, previousFrame,
-                                         clearFragments, projectorProgram,
-                        { object(resultFrame, m, color, rQuad(0.980f)) });
-                }
+        matrix4 outerTransform;
+        matrix4_identity(outerTransform);
+        movev(outerTransform, 0.001*cos(ms/1000.0/50.0));
 
-                {
-                        matrix4 m;
-                        matrix4_identity(m);
-                        movev(m, 0.001*cos(ms/1000.0/50.0));
+        addPass(graph, { resultFrame }, screen, clearFragments,
+        [&](FrameSeries& output, TargetHandle target) {
+                RenderObjectDef const objects[] = {
+                        object(graphTexture(output, graph, resultFrame),
+                               outerTransform, color, all.outerQuad),
+                };
+                drawManyInto(output, target, clearFragments, all.projectorProgram, objects);
+        });
 
-                        drawMany(*output, clearFragments, projectorProgram,
-                        { object(resultFrame, m, color, rQuad(1.0f)) });
-                }
-        }
+        execute(*output, graph);
 }
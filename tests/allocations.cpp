@@ -0,0 +1,62 @@
+#include "tests.hpp"
+
+#include "../src/razorsV2.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+/// of the calling thread, counting allocations when set
+thread_local long* allocationCounter = nullptr;
+}
+
+// every allocation goes through these, including those of the
+// standard library and of operator new[]
+
+void* operator new(size_t size)
+{
+        if (allocationCounter) {
+                ++*allocationCounter;
+        }
+        if (auto memory = std::malloc(size ? size : 1)) {
+                return memory;
+        }
+        throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+        std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+        std::free(memory);
+}
+
+TestStatus testSteadyFrameAllocations(uint64_t time_micros)
+{
+        // programs link asynchronously, resources are created on their
+        // first frames and the statistics history fills up
+        static int const WARMUP_FRAMES = 600;
+        static int const MEASURED_FRAMES = 120;
+
+        static auto razors = makeRazorsV2();
+        static auto frame = 0;
+
+        auto allocations = long(0);
+        if (frame >= WARMUP_FRAMES) {
+                allocationCounter = &allocations;
+        }
+        draw(*razors, time_micros / 1e3);
+        allocationCounter = nullptr;
+        frame++;
+
+        if (allocations > 0) {
+                printf("frame %d allocated %ld times\n", frame, allocations);
+                return TEST_FAILED;
+        }
+        return frame < WARMUP_FRAMES + MEASURED_FRAMES ? TEST_RUNNING : TEST_PASSED;
+}
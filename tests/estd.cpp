@@ -0,0 +1,28 @@
+#include "tests.hpp"
+
+#include "../src/estd.hpp"
+
+#include <cstdio>
+#include <string>
+
+bool testSmallVectorPushesItsOwnElements()
+{
+        // beyond the inline storage of strings
+        auto const value = std::string(64, 'x');
+
+        auto strings = estd::small_vector<std::string, 2> {};
+        strings.push_back(value);
+        for (int i = 0; i < 64; i++) {
+                // every power of two grows the storage
+                strings.push_back(strings[0]);
+                strings.emplace_back(strings.back());
+        }
+
+        for (auto const& string : strings) {
+                if (string != value) {
+                        printf("copied element differs\n");
+                        return false;
+                }
+        }
+        return strings.size() == 129;
+}
@@ -0,0 +1,62 @@
+#include "tests.hpp"
+
+#include "../gl3texture/framegraph.hpp"
+
+#include <cstdio>
+
+bool testFrameGraphCullsAndAliases()
+{
+        auto output = makeFrameSeries();
+        beginFrame(*output);
+
+        auto graph = FrameGraph {};
+        auto const spec = ScratchTargetDef { 64, 64 };
+        auto const screen = importTarget(graph, {});
+        auto const a = transientTarget(graph, spec);
+        auto const b = transientTarget(graph, spec);
+        auto const unread = transientTarget(graph, spec);
+
+        auto const clears = FragmentOperationsDef { FragmentOperationsDef::CLEAR, {} };
+        auto const blends = FragmentOperationsDef {
+                FragmentOperationsDef::BLEND_PREMULTIPLIED_ALPHA, {}
+        };
+
+        bool ran[6] = {};
+        TargetHandle drawnInto[6] = {};
+        auto const record = [&ran, &drawnInto](int pass) {
+                return [&ran, &drawnInto, pass](FrameSeries&, TargetHandle target) {
+                        ran[pass] = true;
+                        drawnInto[pass] = target;
+                };
+        };
+
+        // overwritten by the clear of pass 2 before anything reads it
+        addPass(graph, {}, screen, blends, record(0));
+        addPass(graph, {}, a, clears, record(1));
+        addPass(graph, { a }, screen, clears, record(2));
+        // a is no longer used, b may take its framebuffer
+        addPass(graph, {}, b, clears, record(3));
+        addPass(graph, { b }, screen, blends, record(4));
+        // never read
+        addPass(graph, {}, unread, clears, record(5));
+
+        execute(*output, graph);
+
+        bool const expected[6] = { false, true, true, true, true, false };
+        for (int pass = 0; pass < 6; pass++) {
+                if (ran[pass] != expected[pass]) {
+                        printf("pass %d %s\n", pass, ran[pass] ? "ran" : "was culled");
+                        return false;
+                }
+        }
+
+        auto const& first = drawnInto[1];
+        auto const& second = drawnInto[3];
+        if (!first.defined()
+            || first.slot != second.slot
+            || first.generation != second.generation) {
+                printf("transient targets did not share a scratch target\n");
+                return false;
+        }
+        return true;
+}
@@ -0,0 +1,54 @@
+#include "tests.hpp"
+
+#include "../gl3texture/framepipeline.hpp"
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+bool testPipelineRecordsAheadOnItsThread()
+{
+        auto const glThread = std::this_thread::get_id();
+
+        std::mutex mutex;
+        auto recordedTimes = std::vector<uint64_t> {};
+        auto onGlThread = false;
+
+        auto const start = uint64_t(1000000);
+        auto const frameDuration = uint64_t(16000);
+
+        auto output = makeFrameSeries();
+        {
+                auto pipeline = makeFramePipeline(
+                [&](CommandBuffer&, uint64_t time_micros) {
+                        auto lock = std::unique_lock<std::mutex>(mutex);
+                        recordedTimes.push_back(time_micros);
+                        onGlThread = onGlThread || std::this_thread::get_id() == glThread;
+                });
+
+                for (uint64_t frame = 0; frame < 8; frame++) {
+                        beginFrame(*output);
+                        executeNextFrame(*output, *pipeline, start + frame * frameDuration);
+                }
+        }
+
+        if (onGlThread) {
+                printf("frames were recorded on the GL thread\n");
+                return false;
+        }
+        if (recordedTimes.size() < 8) {
+                printf("only %lu frames recorded\n", recordedTimes.size());
+                return false;
+        }
+        // once the frame duration is known, frames are recorded for
+        // the time they will be shown at
+        for (size_t i = 2; i < recordedTimes.size(); i++) {
+                if (recordedTimes[i] != start + i * frameDuration) {
+                        printf("frame %lu recorded for %lu\n", i,
+                               (unsigned long) recordedTimes[i]);
+                        return false;
+                }
+        }
+        return recordedTimes[0] == start;
+}
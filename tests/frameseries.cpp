@@ -0,0 +1,41 @@
+#include "tests.hpp"
+
+#include "../gl3texture/renderer.hpp"
+
+#include <cstdio>
+
+static TextureDef emptyTexture(int width)
+{
+        return { {}, width, 1, 0, nullptr };
+}
+
+static bool isSameHandle(TextureHandle a, TextureHandle b)
+{
+        return a.slot == b.slot && a.generation == b.generation;
+}
+
+bool testRecyclingSparesEntriesInUse()
+{
+        auto output = makeFrameSeries();
+
+        beginFrame(*output);
+        auto const x = defineTexture(*output, emptyTexture(1));
+        auto const y = defineTexture(*output, emptyTexture(2));
+
+        // the last frame then uses fewer entries than the next one
+        beginFrame(*output);
+        defineTexture(*output, emptyTexture(3));
+
+        beginFrame(*output);
+        defineTexture(*output, emptyTexture(1));
+        defineTexture(*output, emptyTexture(2));
+        defineTexture(*output, emptyTexture(4));
+
+        auto const sameX = isSameHandle(x, defineTexture(*output, emptyTexture(1)));
+        auto const sameY = isSameHandle(y, defineTexture(*output, emptyTexture(2)));
+        if (!sameX || !sameY) {
+                printf("a new definition recycled a texture of its own frame\n");
+                return false;
+        }
+        return true;
+}
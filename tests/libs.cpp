@@ -0,0 +1,2 @@
+// implementations under test, as built for the razors app
+#include "../src/libs.cpp"
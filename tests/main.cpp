@@ -0,0 +1,64 @@
+#include "tests.hpp"
+
+#include "../gl3companion/glstate.hpp"
+
+#include <micros/api.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+static int failureCount = 0;
+
+static void report(char const* name, bool passed)
+{
+        printf("%s: %s\n", passed ? "PASS" : "FAIL", name);
+        if (!passed) {
+                failureCount++;
+        }
+}
+
+extern void render_next_2chn_48khz_audio(uint64_t time_micros,
+                int const sample_count, double left[/*sample_count*/],
+                double right[/*sample_count*/])
+{
+        // silence is soothing
+}
+
+extern void render_next_gl3(uint64_t time_micros)
+{
+        // the runtime may change the GL state between frames
+        glstate::invalidate();
+
+        static auto firstFrame = true;
+        if (firstFrame) {
+                firstFrame = false;
+                report("recycling spares the entries of the current frame",
+                       testRecyclingSparesEntriesInUse());
+                report("stream buffer writes keep their alignment",
+                       testStreamWritesStayAligned());
+                report("frame graphs cull unused passes and alias transients",
+                       testFrameGraphCullsAndAliases());
+                report("frames are recorded ahead on the update thread",
+                       testPipelineRecordsAheadOnItsThread());
+        }
+
+        auto const status = testSteadyFrameAllocations(time_micros);
+        if (status == TEST_RUNNING) {
+                return;
+        }
+        report("steady razors-v2 frames do not allocate", status == TEST_PASSED);
+
+        std::exit(failureCount > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+extern int main()
+{
+        report("small vectors push their own elements",
+               testSmallVectorPushesItsOwnElements());
+        report("object lists do not depend on their workers",
+               testObjectListsAreDeterministic());
+
+        runtime_init();
+
+        return failureCount > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
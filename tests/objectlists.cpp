@@ -0,0 +1,71 @@
+#include "tests.hpp"
+
+#include "../gl3texture/objectlists.hpp"
+
+#include <cstdio>
+
+static constexpr auto POSITION = VertexAttrib<2> { "position" };
+static constexpr auto COLOR = VecUniform<4> { "color" };
+static constexpr auto LAYER = IntUniform<1> { "layer" };
+
+/// uneven, so that chunks finish out of order
+static void buildObject(size_t index, RenderObjectDef& object)
+{
+        auto spin = 0.0f;
+        for (size_t i = 0; i < (index * 7919) % 4096; i++) {
+                spin += 1e-6f;
+        }
+
+        auto const value = float(index);
+        object.inputs.attribs = { POSITION() };
+        object.inputs.floatValues = { COLOR({ value, spin, -value, 1.0f }) };
+        object.inputs.intValues = { LAYER({ int32_t(index % 3) }) };
+        object.mesh = MeshHandle { uint32_t(index), uint32_t(index / 2) };
+}
+
+static bool isSameObject(RenderObjectDef const& a, RenderObjectDef const& b)
+{
+        auto const& x = a.inputs;
+        auto const& y = b.inputs;
+        return x.attribs.size() == y.attribs.size()
+               && x.attribs[0].name == y.attribs[0].name
+               && x.floatValues.size() == y.floatValues.size()
+               && x.floatValues[0].values == y.floatValues[0].values
+               && x.intValues.size() == y.intValues.size()
+               && x.intValues[0].values == y.intValues[0].values
+               && a.mesh.slot == b.mesh.slot
+               && a.mesh.generation == b.mesh.generation;
+}
+
+bool testObjectListsAreDeterministic()
+{
+        size_t const counts[] = { 0, 1, 7, 64, 1000 };
+        size_t const workerCounts[] = { 1, 3, 8 };
+
+        // the calling thread alone builds the reference lists
+        auto sequential = makeObjectListBuilder(0);
+
+        for (auto workerCount : workerCounts) {
+                auto parallel = makeObjectListBuilder(workerCount);
+                for (auto count : counts) {
+                        // repeated builds reuse the storage of the previous ones
+                        for (int repeat = 0; repeat < 4; repeat++) {
+                                auto const expected = buildObjects(*sequential, count, buildObject);
+                                auto const built = buildObjects(*parallel, count, buildObject);
+                                if (built.size() != count) {
+                                        printf("%lu workers: %lu objects instead of %lu\n",
+                                               workerCount, built.size(), count);
+                                        return false;
+                                }
+                                for (size_t i = 0; i < count; i++) {
+                                        if (!isSameObject(built[i], expected[i])) {
+                                                printf("%lu workers: object %lu of %lu differs\n",
+                                                       workerCount, i, count);
+                                                return false;
+                                        }
+                                }
+                        }
+                }
+        }
+        return true;
+}
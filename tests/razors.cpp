@@ -0,0 +1,3 @@
+// razors under test, as built for the razors app
+#include "../src/razors-common.cpp"
+#include "../src/razors-v2.cpp"
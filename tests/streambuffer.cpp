@@ -0,0 +1,33 @@
+#include "tests.hpp"
+
+#include "../gl3companion/glstream.hpp"
+
+#include <cstdio>
+#include <vector>
+
+bool testStreamWritesStayAligned()
+{
+        // small enough to go around the ring many times
+        StreamBuffer stream(size_t(1) << 12);
+
+        auto const bytes = std::vector<char>(size_t(1) << 13);
+        for (int i = 0; i < 1000; i++) {
+                // odd sizes leave the head unaligned for the next write
+                auto const size = size_t(1 + (i * 7) % 61);
+                auto const alignment = size_t(1) << (i % 5);
+                auto const offset = stream.write(&bytes.front(), size, alignment);
+                if (offset % alignment != 0) {
+                        printf("write %d of %lu bytes landed at offset %lu\n",
+                               i, size, offset);
+                        return false;
+                }
+        }
+
+        // beyond a region, which grows the ring
+        auto const offset = stream.write(&bytes.front(), bytes.size(), 16);
+        if (offset % 16 != 0) {
+                printf("write after growth landed at offset %lu\n", offset);
+                return false;
+        }
+        return true;
+}
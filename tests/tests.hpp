@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+enum TestStatus {
+        TEST_RUNNING,
+        TEST_PASSED,
+        TEST_FAILED,
+};
+
+/// of elements referring to the vector itself, while it grows
+bool testSmallVectorPushesItsOwnElements();
+
+/// lists built on worker threads equal those built sequentially
+bool testObjectListsAreDeterministic();
+
+/// GL thread only
+bool testRecyclingSparesEntriesInUse();
+/// GL thread only
+bool testStreamWritesStayAligned();
+/// GL thread only
+bool testFrameGraphCullsAndAliases();
+/// GL thread only
+bool testPipelineRecordsAheadOnItsThread();
+
+/**
+ * frames of razors-v2 past its warm up, which are expected not to
+ * allocate at all. called once per frame from the GL thread.
+ */
+TestStatus testSteadyFrameAllocations(uint64_t time_micros);